@@ -0,0 +1,141 @@
+#include <mochimochi/multi_classifier.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../common.hpp"
+
+namespace {
+  using Examples = std::vector<std::pair<std::size_t, Eigen::SparseVector<double>>>;
+
+  // 1 モデルを n_threads スレッドで epochs 回学習させ、1 秒あたりの update 数と
+  // 評価データでの正解率を返す(正解率はスレッド数によらず同じになる)
+  struct Algorithm {
+    std::string name;
+    std::function<std::pair<double, double>(std::size_t, std::size_t, std::size_t, const Examples&, const Examples&, std::size_t)> run;
+  };
+
+  struct Result {
+    std::string algorithm;
+    std::size_t classes;
+    std::size_t threads;
+    double updates_per_sec;
+    double accuracy;
+  };
+
+  template <typename ModelT>
+  std::pair<double, double> measure(ModelT& model,
+                                    const std::size_t n_threads,
+                                    const Examples& train,
+                                    const Examples& test,
+                                    const std::size_t epochs) {
+    model.set_threads(n_threads);
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t epoch = 0; epoch < epochs; ++epoch) {
+      for (const auto& example : train) { model.update(example.second, example.first); }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const auto count = epochs * train.size();
+
+    std::size_t correct = 0;
+    for (const auto& example : test) { correct += model.predict(example.second) == example.first; }
+    return std::make_pair(count / elapsed.count(), static_cast<double>(correct) / test.size());
+  }
+
+  std::vector<Algorithm> algorithms() {
+    return {
+      { "MAROW", [](std::size_t dim, std::size_t k, std::size_t t, const Examples& train, const Examples& test, std::size_t epochs) {
+          MAROW model(dim, k, 0.5);
+          return measure(model, t, train, test, epochs);
+        } },
+      { "MSCW", [](std::size_t dim, std::size_t k, std::size_t t, const Examples& train, const Examples& test, std::size_t epochs) {
+          MSCW model(dim, k, 1.0, 0.95);
+          return measure(model, t, train, test, epochs);
+        } },
+      { "MNHERD", [](std::size_t dim, std::size_t k, std::size_t t, const Examples& train, const Examples& test, std::size_t epochs) {
+          MNHERD model(dim, k, 0.1, 0);
+          return measure(model, t, train, test, epochs);
+        } },
+      { "MPA", [](std::size_t dim, std::size_t k, std::size_t t, const Examples& train, const Examples& test, std::size_t epochs) {
+          MPA model(dim, k, 1.0, 2);
+          return measure(model, t, train, test, epochs);
+        } },
+    };
+  }
+
+  benchmark::Fields to_fields(const Result& r) {
+    return {
+      benchmark::field("algorithm", r.algorithm),
+      benchmark::field("classes", r.classes),
+      benchmark::field("threads", r.threads),
+      benchmark::field("updates_per_sec", r.updates_per_sec),
+      benchmark::field("accuracy", r.accuracy),
+    };
+  }
+}
+
+int main(const int ac, const char* const * const av) {
+  using namespace boost::program_options;
+
+  options_description description("options");
+  description.add_options()
+    ("help", "")
+    ("algorithms", value<std::string>()->default_value(""), "計測するアルゴリズム(カンマ区切り、空なら全て)")
+    ("classes", value<std::string>()->default_value("10,50,200"), "クラス数(カンマ区切り)")
+    ("threads", value<std::string>()->default_value("1,2,4,8"), "スレッド数(カンマ区切り)")
+    ("dim", value<std::size_t>()->default_value(10000), "データの次元数")
+    ("nnz", value<std::size_t>()->default_value(100), "1事例あたりの非ゼロ要素数")
+    ("train", value<std::size_t>()->default_value(10000), "学習用の合成データの事例数")
+    ("test", value<std::size_t>()->default_value(2000), "評価用の合成データの事例数")
+    ("epochs", value<std::size_t>()->default_value(1), "学習回数")
+    ("seed", value<unsigned>()->default_value(1), "乱数シード")
+    ("output", value<std::string>()->default_value(""), "JSONの出力先(空なら標準出力)");
+
+  variables_map vm;
+  store(parse_command_line(ac, av, description), vm);
+  notify(vm);
+
+  if(vm.count("help")) { std::cout << description << std::endl; return 0; }
+
+  std::vector<std::string> selected;
+  const auto algorithm_names = vm["algorithms"].as<std::string>();
+  if(!algorithm_names.empty()) { boost::split(selected, algorithm_names, boost::is_any_of(",")); }
+  const auto classes = benchmark::parse_list(vm["classes"].as<std::string>());
+  const auto threads = benchmark::parse_list(vm["threads"].as<std::string>());
+  const auto dim = vm["dim"].as<std::size_t>();
+  const auto nnz = vm["nnz"].as<std::size_t>();
+  const auto epochs = vm["epochs"].as<std::size_t>();
+  const auto output_path = vm["output"].as<std::string>();
+  std::mt19937 engine(vm["seed"].as<unsigned>());
+
+  std::vector<Result> results;
+  for(const auto k : classes) {
+    std::normal_distribution<double> normal;
+    Eigen::MatrixXd truth(k, dim);
+    for(std::size_t c = 0; c < k; ++c) {
+      for(std::size_t i = 0; i < dim; ++i) { truth(c, i) = normal(engine); }
+    }
+    const auto train = benchmark::multi_examples(truth, nnz, vm["train"].as<std::size_t>(), engine);
+    const auto test = benchmark::multi_examples(truth, nnz, vm["test"].as<std::size_t>(), engine);
+
+    for(const auto& algorithm : algorithms()) {
+      if(!selected.empty() && std::find(selected.begin(), selected.end(), algorithm.name) == selected.end()) { continue; }
+      for(const auto t : threads) {
+        const auto measured = algorithm.run(dim, k, t, train, test, epochs);
+        results.push_back(Result{ algorithm.name, k, t, measured.first, measured.second });
+        std::cerr << algorithm.name << " classes=" << k << " threads=" << t << " : "
+                  << measured.first << " updates/sec, accuracy " << measured.second << std::endl;
+      }
+    }
+  }
+
+  std::vector<benchmark::Fields> fields;
+  for(const auto& result : results) { fields.push_back(to_fields(result)); }
+  benchmark::write_json(output_path, "class_scaling", { benchmark::field("dim", dim), benchmark::field("nnz", nnz) }, fields);
+
+  return 0;
+}
@@ -0,0 +1,129 @@
+#ifndef MOCHIMOCHI_BENCHMARK_COMMON_HPP_
+#define MOCHIMOCHI_BENCHMARK_COMMON_HPP_
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ベンチマーク共通の部品(引数の解析、合成データ、JSON出力)
+// 各ベンチマークのハイパパラメータは examples のデフォルト値に合わせる
+namespace benchmark {
+  // "1,10,100" -> {1, 10, 100}
+  inline std::vector<std::size_t> parse_list(const std::string& text) {
+    std::vector<std::string> tokens;
+    boost::split(tokens, text, boost::is_any_of(","));
+    std::vector<std::size_t> values;
+    for (const auto& token : tokens) {
+      if (!token.empty()) { values.push_back(std::stoul(token)); }
+    }
+    return values;
+  }
+
+  // min(nnz, dim) 個の相異なる座標に [0, 1) の一様乱数を置いた疎ベクトル
+  inline Eigen::SparseVector<double> random_feature(const std::size_t dim, const std::size_t nnz, std::mt19937& engine) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::uniform_int_distribution<std::size_t> coordinate(0, dim - 1);
+
+    std::vector<std::size_t> indices;
+    while (indices.size() < std::min(nnz, dim)) {
+      while (indices.size() < std::min(nnz, dim)) { indices.push_back(coordinate(engine)); }
+      std::sort(indices.begin(), indices.end());
+      indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    }
+
+    Eigen::SparseVector<double> feature(dim);
+    feature.reserve(indices.size());
+    for (const auto index : indices) { feature.insertBack(index) = uniform(engine); }
+    return feature;
+  }
+
+  // 隠れ重みの符号で付けたラベルを 10% 反転させた合成データ
+  inline std::vector<std::pair<int, Eigen::SparseVector<double>>> binary_examples(const Eigen::VectorXd& truth,
+                                                                                  const std::size_t nnz,
+                                                                                  const std::size_t n,
+                                                                                  std::mt19937& engine) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<std::pair<int, Eigen::SparseVector<double>>> examples(n);
+    for (auto& example : examples) {
+      example.second = random_feature(truth.size(), nnz, engine);
+      const auto label = example.second.dot(truth) > 0.0 ? 1 : -1;
+      example.first = uniform(engine) < 0.1 ? -label : label;
+    }
+    return examples;
+  }
+
+  // クラスごとの隠れ重みで最もスコアの高いクラス(1..k)をラベルにした合成データ
+  inline std::vector<std::pair<std::size_t, Eigen::SparseVector<double>>> multi_examples(const Eigen::MatrixXd& truth,
+                                                                                         const std::size_t nnz,
+                                                                                         const std::size_t n,
+                                                                                         std::mt19937& engine) {
+    std::vector<std::pair<std::size_t, Eigen::SparseVector<double>>> examples(n);
+    for (auto& example : examples) {
+      example.second = random_feature(truth.cols(), nnz, engine);
+      Eigen::VectorXd scores = truth * Eigen::VectorXd(example.second);
+      Eigen::Index best;
+      scores.maxCoeff(&best);
+      example.first = best + 1;
+    }
+    return examples;
+  }
+
+  /**
+   * JSON の1オブジェクト分の (キー, 値) の並び。値は JSON に書く形に整形済み
+   */
+  using Fields = std::vector<std::pair<std::string, std::string>>;
+
+  template <typename T>
+  std::pair<std::string, std::string> field(const std::string& key, const T& value) {
+    std::ostringstream os;
+    os << value;
+    return std::make_pair(key, os.str());
+  }
+
+  inline std::pair<std::string, std::string> field(const std::string& key, const std::string& value) {
+    return std::make_pair(key, "\"" + value + "\"");
+  }
+
+  inline std::pair<std::string, std::string> field(const std::string& key, const char* value) {
+    return field(key, std::string(value));
+  }
+
+  // {"benchmark": name, <header>..., "results": [<result>, ...]}
+  inline void write_json(std::ostream& os, const std::string& name, const Fields& header, const std::vector<Fields>& results) {
+    os << "{\n"
+       << "  \"benchmark\": \"" << name << "\",\n";
+    for (const auto& f : header) {
+      os << "  \"" << f.first << "\": " << f.second << ",\n";
+    }
+    os << "  \"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      os << "    {";
+      for (std::size_t j = 0; j < results[i].size(); ++j) {
+        os << (j == 0 ? "" : ", ") << "\"" << results[i][j].first << "\": " << results[i][j].second;
+      }
+      os << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n"
+       << "}" << std::endl;
+  }
+
+  // path が空なら標準出力に書く
+  inline void write_json(const std::string& path, const std::string& name, const Fields& header, const std::vector<Fields>& results) {
+    if (path.empty()) {
+      write_json(std::cout, name, header, results);
+    } else {
+      std::ofstream ofs(path);
+      write_json(ofs, name, header, results);
+    }
+  }
+}
+
+#endif //MOCHIMOCHI_BENCHMARK_COMMON_HPP_
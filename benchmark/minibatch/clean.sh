@@ -0,0 +1,5 @@
+rm -f CMakeCache.txt
+rm -rf CMakeFiles
+rm -f Makefile
+rm -f cmake_install.cmake
+rm -f minibatch
@@ -0,0 +1,168 @@
+#include <mochimochi/binary_classifier.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../common.hpp"
+
+namespace {
+  struct Algorithm {
+    std::string name;
+    std::function<BinaryOML*(std::size_t, std::size_t)> create;
+  };
+
+  struct Result {
+    std::string algorithm;
+    std::size_t batch_size;
+    std::string input;
+    double updates_per_sec;
+    double update_ratio;
+    double accuracy;
+  };
+
+  std::vector<Algorithm> algorithms() {
+    return {
+      { "ADAM", [](std::size_t dim, std::size_t batch_size) { return new ADAM(dim, batch_size); } },
+      { "ADAGRAD_RDA", [](std::size_t dim, std::size_t batch_size) { return new ADAGRAD_RDA(dim, 0.1, 0.000001, batch_size); } },
+    };
+  }
+
+  // epochs 回学習した新しいモデルの評価データでの正解率
+  template <typename FeatureT>
+  double accuracy(const Algorithm& algorithm,
+                  const std::size_t dim,
+                  const std::size_t batch_size,
+                  const std::vector<std::pair<int, FeatureT>>& train,
+                  const std::vector<std::pair<int, FeatureT>>& test,
+                  const std::size_t epochs) {
+    std::unique_ptr<BinaryOML> model(algorithm.create(dim, batch_size));
+    for (std::size_t epoch = 0; epoch < epochs; ++epoch) {
+      for (const auto& example : train) { model->update(example.second, example.first); }
+    }
+    model->flush();
+
+    std::size_t correct = 0;
+    for (const auto& example : test) { correct += model->predict(example.second) == example.first; }
+    return static_cast<double>(correct) / test.size();
+  }
+
+  // 最低 min_time 秒になるまで学習データを繰り返し流し、1 秒あたりの update 数と
+  // 損失のあった事例の割合を返す
+  template <typename FeatureT>
+  std::pair<double, double> updates_per_sec(const Algorithm& algorithm,
+                                            const std::size_t dim,
+                                            const std::size_t batch_size,
+                                            const std::vector<std::pair<int, FeatureT>>& train,
+                                            const double min_time) {
+    std::unique_ptr<BinaryOML> model(algorithm.create(dim, batch_size));
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t count = 0;
+    std::size_t updated = 0;
+    std::chrono::duration<double> elapsed;
+    do {
+      for (const auto& example : train) { updated += model->update(example.second, example.first); }
+      count += train.size();
+      elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed.count() < min_time);
+    return std::make_pair(count / elapsed.count(), static_cast<double>(updated) / count);
+  }
+
+  template <typename FeatureT>
+  Result run(const Algorithm& algorithm,
+             const std::size_t dim,
+             const std::size_t batch_size,
+             const std::string& input,
+             const std::vector<std::pair<int, FeatureT>>& train,
+             const std::vector<std::pair<int, FeatureT>>& test,
+             const std::size_t epochs,
+             const double min_time) {
+    const auto updates = updates_per_sec(algorithm, dim, batch_size, train, min_time);
+    return Result{ algorithm.name, batch_size, input, updates.first, updates.second,
+                   accuracy(algorithm, dim, batch_size, train, test, epochs) };
+  }
+
+  benchmark::Fields to_fields(const Result& r) {
+    return {
+      benchmark::field("algorithm", r.algorithm),
+      benchmark::field("batch_size", r.batch_size),
+      benchmark::field("input", r.input),
+      benchmark::field("updates_per_sec", r.updates_per_sec),
+      benchmark::field("update_ratio", r.update_ratio),
+      benchmark::field("accuracy", r.accuracy),
+    };
+  }
+}
+
+int main(const int ac, const char* const * const av) {
+  using namespace boost::program_options;
+
+  options_description description("options");
+  description.add_options()
+    ("help", "")
+    ("batch-sizes", value<std::string>()->default_value("1,2,4,8,16,32,64,128"), "ミニバッチの大きさ(カンマ区切り)")
+    ("dim", value<std::size_t>()->default_value(100000), "データの次元数")
+    ("nnz", value<std::size_t>()->default_value(100), "1事例あたりの非ゼロ要素数")
+    ("input", value<std::string>()->default_value("sparse"), "入力ベクトルの形式(sparse, dense, both)")
+    ("train", value<std::size_t>()->default_value(10000), "学習用の合成データの事例数")
+    ("test", value<std::size_t>()->default_value(10000), "評価用の合成データの事例数")
+    ("epochs", value<std::size_t>()->default_value(1), "正解率を測るモデルの学習回数")
+    ("min-time", value<double>()->default_value(0.2), "1計測あたりの最低時間(秒)")
+    ("seed", value<unsigned>()->default_value(1), "乱数シード")
+    ("output", value<std::string>()->default_value(""), "JSONの出力先(空なら標準出力)");
+
+  variables_map vm;
+  store(parse_command_line(ac, av, description), vm);
+  notify(vm);
+
+  if(vm.count("help")) { std::cout << description << std::endl; return 0; }
+
+  const auto batch_sizes = benchmark::parse_list(vm["batch-sizes"].as<std::string>());
+  const auto dim = vm["dim"].as<std::size_t>();
+  const auto nnz = vm["nnz"].as<std::size_t>();
+  const auto input = vm["input"].as<std::string>();
+  const auto epochs = vm["epochs"].as<std::size_t>();
+  const auto min_time = vm["min-time"].as<double>();
+  const auto output_path = vm["output"].as<std::string>();
+  std::mt19937 engine(vm["seed"].as<unsigned>());
+
+  std::normal_distribution<double> normal;
+  Eigen::VectorXd truth(dim);
+  for (std::size_t i = 0; i < dim; ++i) { truth[i] = normal(engine); }
+  const auto sparse_train = benchmark::binary_examples(truth, nnz, vm["train"].as<std::size_t>(), engine);
+  const auto sparse_test = benchmark::binary_examples(truth, nnz, vm["test"].as<std::size_t>(), engine);
+
+  std::vector<std::pair<int, Eigen::VectorXd>> dense_train;
+  std::vector<std::pair<int, Eigen::VectorXd>> dense_test;
+  if(input != "sparse") {
+    for(const auto& example : sparse_train) { dense_train.emplace_back(example.first, Eigen::VectorXd(example.second)); }
+    for(const auto& example : sparse_test) { dense_test.emplace_back(example.first, Eigen::VectorXd(example.second)); }
+  }
+
+  std::vector<Result> results;
+  for(const auto& algorithm : algorithms()) {
+    for(const auto batch_size : batch_sizes) {
+      if(input != "dense") {
+        results.push_back(run(algorithm, dim, batch_size, "sparse", sparse_train, sparse_test, epochs, min_time));
+        std::cerr << algorithm.name << " B=" << batch_size << " sparse : "
+                  << results.back().updates_per_sec << " updates/sec, update ratio "
+                  << results.back().update_ratio << ", accuracy " << results.back().accuracy << std::endl;
+      }
+      if(input != "sparse") {
+        results.push_back(run(algorithm, dim, batch_size, "dense", dense_train, dense_test, epochs, min_time));
+        std::cerr << algorithm.name << " B=" << batch_size << " dense  : "
+                  << results.back().updates_per_sec << " updates/sec, update ratio "
+                  << results.back().update_ratio << ", accuracy " << results.back().accuracy << std::endl;
+      }
+    }
+  }
+
+  std::vector<benchmark::Fields> fields;
+  for(const auto& result : results) { fields.push_back(to_fields(result)); }
+  benchmark::write_json(output_path, "minibatch", { benchmark::field("dim", dim), benchmark::field("nnz", nnz) }, fields);
+  return 0;
+}
@@ -0,0 +1,64 @@
+#include <mochimochi/utility.hpp>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+template <typename FunctionT>
+double lines_per_second(const std::vector<std::string>& lines, const std::size_t repeat, FunctionT func) {
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < repeat; ++i) {
+    for (const auto& line : lines) { func(line); }
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return lines.size() * repeat / elapsed.count();
+}
+
+int main(const int ac, const char* const * const av) {
+  using namespace boost::program_options;
+
+  options_description description("options");
+  description.add_options()
+    ("help", "")
+    ("dim", value<std::size_t>()->default_value(0), "データの次元数")
+    ("data", value<std::string>()->default_value(""), "svmlight形式のファイルパス")
+    ("repeat", value<std::size_t>()->default_value(20), "繰り返し回数");
+
+  variables_map vm;
+  store(parse_command_line(ac, av, description), vm);
+  notify(vm);
+
+  if(vm.count("help")) { std::cout << description << std::endl; }
+
+  const auto dim = vm["dim"].as<std::size_t>();
+  const auto data_path = vm["data"].as<std::string>();
+  const auto repeat = vm["repeat"].as<std::size_t>();
+
+  std::vector<std::string> lines;
+  std::string line;
+  std::ifstream data(data_path);
+  while(std::getline(data, line)) {
+    if(!line.empty() && line[0] != '#') { lines.push_back(line); }
+  }
+
+  auto read_ones_sum = 0.0;
+  const auto read_ones_rate = lines_per_second(lines, repeat, [&](const std::string& l) {
+      const auto parsed = utility::read_ones<int>(l, dim);
+      read_ones_sum += parsed.first + parsed.second.sum();
+    });
+
+  auto parse_sum = 0.0;
+  int label = 0;
+  Eigen::SparseVector<double> feature;
+  const auto parse_rate = lines_per_second(lines, repeat, [&](const std::string& l) {
+      utility::parse_svmlight_line(l, dim, label, feature);
+      parse_sum += label + feature.sum();
+    });
+
+  std::cout << "lines = " << lines.size() << " x " << repeat << std::endl;
+  std::cout << "read_ones           : " << read_ones_rate << " lines/sec" << std::endl;
+  std::cout << "parse_svmlight_line : " << parse_rate << " lines/sec" << std::endl;
+  std::cout << "speedup = " << parse_rate / read_ones_rate << "x (checksum " << read_ones_sum << " / " << parse_sum << ")" << std::endl;
+
+  return 0;
+}
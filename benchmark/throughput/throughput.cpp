@@ -0,0 +1,211 @@
+#include <mochimochi/binary_classifier.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../common.hpp"
+
+namespace {
+  struct Algorithm {
+    std::string name;
+    std::function<BinaryOML*(std::size_t)> create;
+  };
+
+  struct Result {
+    std::string algorithm;
+    std::size_t dim;
+    std::size_t nnz;
+    std::string input;
+    std::size_t examples;
+    double updates_per_sec;
+    double predicts_per_sec;
+    double batch_predicts_per_sec;
+    double update_ratio;
+  };
+
+  std::vector<Algorithm> algorithms() {
+    return {
+      { "AROW", [](std::size_t dim) { return new AROW(dim, 0.8); } },
+      { "SCW", [](std::size_t dim) { return new SCW(dim, 1.0, 0.95); } },
+      { "NHERD-full", [](std::size_t dim) { return new NHERD(dim, 0.1, 0); } },
+      { "NHERD-exact", [](std::size_t dim) { return new NHERD(dim, 0.1, 1); } },
+      { "NHERD-project", [](std::size_t dim) { return new NHERD(dim, 0.1, 2); } },
+      { "NHERD-drop", [](std::size_t dim) { return new NHERD(dim, 0.1, 3); } },
+      { "BasicNHERD<Full>", [](std::size_t dim) { return new BasicNHERD<nherd::Full>(dim, 0.1); } },
+      { "BasicNHERD<Exact>", [](std::size_t dim) { return new BasicNHERD<nherd::Exact>(dim, 0.1); } },
+      { "BasicNHERD<Project>", [](std::size_t dim) { return new BasicNHERD<nherd::Project>(dim, 0.1); } },
+      { "BasicNHERD<Drop>", [](std::size_t dim) { return new BasicNHERD<nherd::Drop>(dim, 0.1); } },
+      { "PA", [](std::size_t dim) { return new PA(dim, 1.0, 0); } },
+      { "PA-I", [](std::size_t dim) { return new PA(dim, 1.0, 1); } },
+      { "PA-II", [](std::size_t dim) { return new PA(dim, 1.0, 2); } },
+      { "BasicPA<Plain>", [](std::size_t dim) { return new BasicPA<pa::Plain>(dim, 1.0); } },
+      { "BasicPA<I>", [](std::size_t dim) { return new BasicPA<pa::I>(dim, 1.0); } },
+      { "BasicPA<II>", [](std::size_t dim) { return new BasicPA<pa::II>(dim, 1.0); } },
+      { "ADAM", [](std::size_t dim) { return new ADAM(dim); } },
+      { "ADAGRAD_RDA", [](std::size_t dim) { return new ADAGRAD_RDA(dim, 0.1, 0.000001); } },
+      { "AROWf", [](std::size_t dim) { return new AROWf(dim, 0.8); } },
+      { "SCWf", [](std::size_t dim) { return new SCWf(dim, 1.0, 0.95); } },
+      { "NHERDf-full", [](std::size_t dim) { return new NHERDf(dim, 0.1, 0); } },
+      { "PAf-II", [](std::size_t dim) { return new PAf(dim, 1.0, 2); } },
+      { "ADAMf", [](std::size_t dim) { return new ADAMf(dim); } },
+      { "ADAGRAD_RDAf", [](std::size_t dim) { return new ADAGRAD_RDAf(dim, 0.1, 0.000001); } },
+    };
+  }
+
+  // 最低 min_time 秒になるまでデータを繰り返し流し、1 秒あたりの処理数を返す
+  template <typename FunctionT>
+  double per_second(const std::size_t n, const double min_time, FunctionT func) {
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t count = 0;
+    std::chrono::duration<double> elapsed;
+    do {
+      for (std::size_t i = 0; i < n; ++i) { func(i); }
+      count += n;
+      elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed.count() < min_time);
+    return count / elapsed.count();
+  }
+
+  // predict_batch に渡す行列(1行1事例)
+  BinaryOML::CsrMatrix to_batch(const std::vector<std::pair<int, Eigen::SparseVector<double>>>& examples, const std::size_t dim) {
+    std::vector<Eigen::Triplet<double>> triplets;
+    for (std::size_t row = 0; row < examples.size(); ++row) {
+      for (Eigen::SparseVector<double>::InnerIterator it(examples[row].second); it; ++it) {
+        triplets.emplace_back(row, it.index(), it.value());
+      }
+    }
+    BinaryOML::CsrMatrix batch(examples.size(), dim);
+    batch.setFromTriplets(triplets.begin(), triplets.end());
+    return batch;
+  }
+
+  Eigen::MatrixXd to_batch(const std::vector<std::pair<int, Eigen::VectorXd>>& examples, const std::size_t dim) {
+    Eigen::MatrixXd batch(examples.size(), dim);
+    for (std::size_t row = 0; row < examples.size(); ++row) { batch.row(row) = examples[row].second.transpose(); }
+    return batch;
+  }
+
+  template <typename FeatureT>
+  Result run(const Algorithm& algorithm,
+             const std::size_t dim,
+             const std::size_t nnz,
+             const std::string& input,
+             const std::vector<std::pair<int, FeatureT>>& examples,
+             const double min_time,
+             long& checksum) {
+    std::unique_ptr<BinaryOML> model(algorithm.create(dim));
+
+    std::size_t updated = 0;
+    std::size_t calls = 0;
+    const auto updates = per_second(examples.size(), min_time, [&](const std::size_t i) {
+        updated += model->update(examples[i].second, examples[i].first);
+        ++calls;
+      });
+    const auto predicts = per_second(examples.size(), min_time, [&](const std::size_t i) {
+        checksum += model->predict(examples[i].second);
+      });
+    const auto batch = to_batch(examples, dim);
+    const auto batch_predicts = examples.size() * per_second(1, min_time, [&](const std::size_t) {
+        checksum += model->predict_batch(batch).sum();
+      });
+
+    return Result{ algorithm.name, dim, nnz, input, examples.size(), updates, predicts, batch_predicts, static_cast<double>(updated) / calls };
+  }
+
+  benchmark::Fields to_fields(const Result& r) {
+    return {
+      benchmark::field("algorithm", r.algorithm),
+      benchmark::field("dim", r.dim),
+      benchmark::field("nnz", r.nnz),
+      benchmark::field("input", r.input),
+      benchmark::field("examples", r.examples),
+      benchmark::field("updates_per_sec", r.updates_per_sec),
+      benchmark::field("predicts_per_sec", r.predicts_per_sec),
+      benchmark::field("batch_predicts_per_sec", r.batch_predicts_per_sec),
+      benchmark::field("update_ratio", r.update_ratio),
+    };
+  }
+}
+
+int main(const int ac, const char* const * const av) {
+  using namespace boost::program_options;
+
+  options_description description("options");
+  description.add_options()
+    ("help", "")
+    ("algorithms", value<std::string>()->default_value(""), "計測するアルゴリズム(カンマ区切り、空なら全て)")
+    ("dims", value<std::string>()->default_value("1000,100000,1000000"), "データの次元数(カンマ区切り)")
+    ("nnz", value<std::string>()->default_value("10,100,1000"), "1事例あたりの非ゼロ要素数(カンマ区切り)")
+    ("input", value<std::string>()->default_value("sparse"), "入力ベクトルの形式(sparse, dense, both)")
+    ("examples", value<std::size_t>()->default_value(1000), "合成データの事例数")
+    ("min-time", value<double>()->default_value(0.2), "1計測あたりの最低時間(秒)")
+    ("seed", value<unsigned>()->default_value(1), "乱数シード")
+    ("output", value<std::string>()->default_value(""), "JSONの出力先(空なら標準出力)");
+
+  variables_map vm;
+  store(parse_command_line(ac, av, description), vm);
+  notify(vm);
+
+  if(vm.count("help")) { std::cout << description << std::endl; return 0; }
+
+  std::vector<std::string> selected;
+  const auto algorithm_names = vm["algorithms"].as<std::string>();
+  if(!algorithm_names.empty()) { boost::split(selected, algorithm_names, boost::is_any_of(",")); }
+  const auto dims = benchmark::parse_list(vm["dims"].as<std::string>());
+  const auto nnzs = benchmark::parse_list(vm["nnz"].as<std::string>());
+  const auto input = vm["input"].as<std::string>();
+  const auto n_examples = vm["examples"].as<std::size_t>();
+  const auto min_time = vm["min-time"].as<double>();
+  const auto output_path = vm["output"].as<std::string>();
+  std::mt19937 engine(vm["seed"].as<unsigned>());
+
+  // 密ベクトルは次元数に比例してメモリを使うので、事例数を 256MB に収まる数に抑える
+  constexpr std::size_t kDenseBudget = std::size_t(1) << 28;
+
+  std::vector<Result> results;
+  long checksum = 0;
+  for(const auto dim : dims) {
+    for(const auto nnz : nnzs) {
+      std::normal_distribution<double> normal;
+      Eigen::VectorXd truth(dim);
+      for (std::size_t i = 0; i < dim; ++i) { truth[i] = normal(engine); }
+      const auto sparse = benchmark::binary_examples(truth, nnz, n_examples, engine);
+
+      std::vector<std::pair<int, Eigen::VectorXd>> dense;
+      if(input != "sparse") {
+        const auto n_dense = std::max<std::size_t>(1, std::min(n_examples, kDenseBudget / (dim * sizeof(double))));
+        for(std::size_t i = 0; i < n_dense; ++i) { dense.emplace_back(sparse[i].first, Eigen::VectorXd(sparse[i].second)); }
+      }
+
+      for(const auto& algorithm : algorithms()) {
+        if(!selected.empty() && std::find(selected.begin(), selected.end(), algorithm.name) == selected.end()) { continue; }
+        if(input != "dense") {
+          results.push_back(run(algorithm, dim, nnz, "sparse", sparse, min_time, checksum));
+          std::cerr << algorithm.name << " dim=" << dim << " nnz=" << nnz << " sparse : "
+                    << results.back().updates_per_sec << " updates/sec, "
+                    << results.back().predicts_per_sec << " predicts/sec, "
+                    << results.back().batch_predicts_per_sec << " batch predicts/sec" << std::endl;
+        }
+        if(input != "sparse") {
+          results.push_back(run(algorithm, dim, nnz, "dense", dense, min_time, checksum));
+          std::cerr << algorithm.name << " dim=" << dim << " nnz=" << nnz << " dense  : "
+                    << results.back().updates_per_sec << " updates/sec, "
+                    << results.back().predicts_per_sec << " predicts/sec, "
+                    << results.back().batch_predicts_per_sec << " batch predicts/sec" << std::endl;
+        }
+      }
+    }
+  }
+
+  std::vector<benchmark::Fields> fields;
+  for(const auto& result : results) { fields.push_back(to_fields(result)); }
+  benchmark::write_json(output_path, "throughput", { benchmark::field("min_time", min_time) }, fields);
+  std::cerr << "checksum = " << checksum << std::endl;
+
+  return 0;
+}
@@ -23,24 +23,18 @@ int main(const int ac, const char* const * const av) {
   const auto train_path = vm["train"].as<std::string>();
   const auto test_path = vm["test"].as<std::string>();
 
-  std::string line;
-  std::ifstream train_data(train_path);
-
   ADAM adam(dim);
   std::cout << "training..." << std::endl;
-  while(std::getline(train_data, line)) {
-    auto data = utility::read_ones<int>(line, dim);
-    adam.update(data.second, data.first);
+  for(const auto& example : utility::SvmlightReader<int>(train_path, dim)) {
+    adam.update(example.feature, example.label);
   }
 
   int collect = 0;
   int all = 0;
-  std::ifstream test_data(test_path);
   std::cout << "predicting..." << std::endl;
-  while(std::getline(test_data, line)) {
-    auto data = utility::read_ones<int>(line, dim);
-    int pred = adam.predict(data.second);
-    if(pred == data.first) {
+  for(const auto& example : utility::SvmlightReader<int>(test_path, dim)) {
+    int pred = adam.predict(example.feature);
+    if(pred == example.label) {
       ++collect;
     }
     ++all;
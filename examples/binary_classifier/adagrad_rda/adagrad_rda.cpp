@@ -27,24 +27,20 @@ int main(const int ac, const char* const * const av) {
   const auto eta = vm["eta"].as<double>();
   const auto lambda = vm["lambda"].as<double>();
 
-  std::string line;
-  std::ifstream train_data(train_path);
-
   ADAGRAD_RDA rda(dim, eta, lambda);
   std::cout << "training..." << std::endl;
-  while(std::getline(train_data, line)) {
-    auto data = utility::read_ones<int>(line, dim);
-    rda.update(data.second, data.first);
+  for(const auto& example : utility::SvmlightReader<int>(train_path, dim)) {
+    rda.update(example.feature, example.label);
   }
+  // 学習後の重みを確定させておくと predict が内積だけで済む
+  rda.materialize();
 
   int collect = 0;
   int all = 0;
-  std::ifstream test_data(test_path);
   std::cout << "predicting..." << std::endl;
-  while(std::getline(test_data, line)) {
-    auto data = utility::read_ones<int>(line, dim);
-    auto pred = rda.predict(data.second);
-    if(pred == data.first) {
+  for(const auto& example : utility::SvmlightReader<int>(test_path, dim)) {
+    auto pred = rda.predict(example.feature);
+    if(pred == example.label) {
       ++collect;
     }
     ++all;
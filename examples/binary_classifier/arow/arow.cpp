@@ -12,7 +12,8 @@ int main(const int ac, const char* const * const av) {
     ("dim", value<std::size_t>()->default_value(0), "データの次元数")
     ("train", value<std::string>()->default_value(""), "学習データのファイルパス")
     ("test", value<std::string>()->default_value(""), "評価データのファイルパス")
-    ("r", value<double>()->default_value(0.5), "ハイパパラメータ(r)");
+    ("r", value<double>()->default_value(0.5), "ハイパパラメータ(r)")
+    ("cache", value<std::string>()->default_value(""), "評価データを変換するCSRキャッシュのパス(指定するとキャッシュで一括予測する)");
 
   variables_map vm;
   store(parse_command_line(ac, av, description), vm);
@@ -24,28 +25,35 @@ int main(const int ac, const char* const * const av) {
   const auto train_path = vm["train"].as<std::string>();
   const auto test_path = vm["test"].as<std::string>();
   const auto r = vm["r"].as<double>();
-
-  std::string line;
-  std::ifstream train_data(train_path);
+  const auto cache_path = vm["cache"].as<std::string>();
 
   AROW arow(dim, r);
   std::cout << "training..." << std::endl;
-  while(std::getline(train_data, line)) {
-    auto data = utility::read_ones<int>(line, dim);
-    arow.update(data.second, data.first);
+  for(const auto& example : utility::SvmlightReader<int>(train_path, dim)) {
+    arow.update(example.feature, example.label);
   }
 
   auto collect = 0;
   auto all = 0;
-  std::ifstream test_data(test_path);
   std::cout << "predicting..." << std::endl;
-  while(std::getline(test_data, line)) {
-    auto data = utility::read_ones<int>(line, dim);
-    auto pred = arow.predict(data.second);
-    if(pred == data.first) {
-      ++collect;
+  if(cache_path.empty()) {
+    for(const auto& example : utility::SvmlightReader<int>(test_path, dim)) {
+      auto pred = arow.predict(example.feature);
+      if(pred == example.label) {
+        ++collect;
+      }
+      ++all;
+    }
+  } else {
+    utility::write_csr_cache(test_path, cache_path, dim);
+    const utility::CsrDataset<int> test(cache_path);
+    const auto preds = arow.predict_batch(test);
+    for(std::size_t row = 0; row < test.rows(); ++row) {
+      if(preds[row] == test.label(row)) {
+        ++collect;
+      }
+      ++all;
     }
-    ++all;
   }
 
   std::cout << "Accuracy = " << (100.0 * collect / all) << "% (" << collect << "/" << all << ")" << std::endl;
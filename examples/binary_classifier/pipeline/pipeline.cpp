@@ -0,0 +1,66 @@
+#include <mochimochi/classifier/factory/binary_oml_pipeline.hpp>
+#include <mochimochi/utility/decompressing_reader.hpp>
+#include <mochimochi/utility.hpp>
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <memory>
+#include <unistd.h>
+
+int main(const int ac, const char* const * const av) {
+  using namespace boost::program_options;
+
+  options_description description("options");
+  description.add_options()
+    ("help", "")
+    ("dim", value<std::size_t>()->default_value(0), "データの次元数")
+    ("train", value<std::string>()->default_value(""), "学習データのファイルパス(gzip/zstd可、省略時は標準入力)")
+    ("test", value<std::string>()->default_value(""), "評価データのファイルパス")
+    ("model", value<std::string>()->default_value(""), "モデルの保存先")
+    ("capacity", value<std::size_t>()->default_value(1024), "リングバッファの容量")
+    ("r", value<double>()->default_value(0.5), "ハイパパラメータ(r)");
+
+  variables_map vm;
+  store(parse_command_line(ac, av, description), vm);
+  notify(vm);
+
+  if(vm.count("help")) { std::cout << description << std::endl; }
+
+  const auto dim = vm["dim"].as<std::size_t>();
+  const auto train_path = vm["train"].as<std::string>();
+  const auto test_path = vm["test"].as<std::string>();
+  const auto model_path = vm["model"].as<std::string>();
+  const auto capacity = vm["capacity"].as<std::size_t>();
+  const auto r = vm["r"].as<double>();
+
+  // 圧縮ファイルは別スレッドで展開し、パイプ経由でパーサに渡す
+  std::unique_ptr<utility::DecompressingPipe> input;
+  if(!train_path.empty()) { input.reset(new utility::DecompressingPipe(train_path)); }
+
+  BinaryAROWCreator creator(dim, r);
+  BinaryOMLPipeline pipeline(creator, input ? input->fd() : STDIN_FILENO, dim, capacity);
+
+  std::cout << "training from " << (input ? train_path : "stdin") << "..." << std::endl;
+  pipeline.run();
+  if(input) { input->finish(); }
+  const auto stats = pipeline.stats();
+  std::cout << "trained = " << stats.trained
+            << ", reader stalls = " << stats.producerStalls
+            << ", trainer stalls = " << stats.consumerStalls << std::endl;
+
+  if(!model_path.empty()) { creator.save(model_path); }
+  if(test_path.empty()) { return 0; }
+
+  auto collect = 0;
+  auto all = 0;
+  std::cout << "predicting..." << std::endl;
+  for(const auto& example : utility::SvmlightReader<int>(test_path, dim)) {
+    if(creator.FactoryMethod()->predict(example.feature) == example.label) {
+      ++collect;
+    }
+    ++all;
+  }
+
+  std::cout << "Accuracy = " << (100.0 * collect / all) << "% (" << collect << "/" << all << ")" << std::endl;
+
+  return 0;
+}
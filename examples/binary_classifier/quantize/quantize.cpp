@@ -0,0 +1,115 @@
+#include <mochimochi/binary_classifier.hpp>
+#include <mochimochi/utility.hpp>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+std::unique_ptr<BinaryOML> make_model(const std::string& algorithm, const std::size_t dim) {
+  if (algorithm == "AROW") { return std::unique_ptr<BinaryOML>(new AROW(dim, 0.5)); }
+  if (algorithm == "SCW") { return std::unique_ptr<BinaryOML>(new SCW(dim, 1.0, 0.95)); }
+  if (algorithm == "NHERD") { return std::unique_ptr<BinaryOML>(new NHERD(dim, 0.1, 0)); }
+  if (algorithm == "PA") { return std::unique_ptr<BinaryOML>(new PA(dim, 1.0, 2)); }
+  if (algorithm == "ADAM") { return std::unique_ptr<BinaryOML>(new ADAM(dim)); }
+  if (algorithm == "ADAGRAD_RDA") { return std::unique_ptr<BinaryOML>(new ADAGRAD_RDA(dim, 0.1, 0.000001)); }
+  throw std::runtime_error("Unknown algorithm: " + algorithm);
+}
+
+// 正解数と予測1回あたりの時間(ns)。時間は評価データを最低 0.2 秒繰り返し流して測る
+template <typename ModelT, typename FeatureT>
+std::pair<int, double> evaluate(const ModelT& model, const std::vector<FeatureT>& features, const std::vector<int>& labels) {
+  auto collect = 0;
+  for (std::size_t i = 0; i < features.size(); ++i) {
+    if (model.predict(features[i]) == labels[i]) { ++collect; }
+  }
+
+  std::size_t count = 0;
+  auto checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  std::chrono::duration<double, std::nano> elapsed;
+  do {
+    for (const auto& feature : features) { checksum += model.predict(feature); }
+    count += features.size();
+    elapsed = std::chrono::steady_clock::now() - start;
+  } while (elapsed.count() < 0.2e9);
+  if (checksum == 0x7fffffff) { std::cerr << checksum << std::endl; }
+  return std::make_pair(collect, elapsed.count() / count);
+}
+
+int main(const int ac, const char* const * const av) {
+  using namespace boost::program_options;
+
+  options_description description("options");
+  description.add_options()
+    ("help", "")
+    ("dim", value<std::size_t>()->default_value(0), "データの次元数")
+    ("train", value<std::string>()->default_value(""), "学習データのファイルパス")
+    ("test", value<std::string>()->default_value(""), "評価データのファイルパス")
+    ("algorithm", value<std::string>()->default_value("AROW"), "アルゴリズム(AROW, SCW, NHERD, PA, ADAM, ADAGRAD_RDA)")
+    ("block", value<std::size_t>()->default_value(128), "スケールを共有する次元数(2のべき乗、32以上)")
+    ("output", value<std::string>()->default_value(""), "量子化モデルの保存先(<output>.q8, <output>.f16)");
+
+  variables_map vm;
+  store(parse_command_line(ac, av, description), vm);
+  notify(vm);
+
+  if(vm.count("help")) { std::cout << description << std::endl; }
+
+  const auto dim = vm["dim"].as<std::size_t>();
+  const auto train_path = vm["train"].as<std::string>();
+  const auto test_path = vm["test"].as<std::string>();
+  const auto algorithm = vm["algorithm"].as<std::string>();
+  const auto block = vm["block"].as<std::size_t>();
+  const auto output = vm["output"].as<std::string>();
+
+  auto model = make_model(algorithm, dim);
+  std::cout << "training " << model->name() << "..." << std::endl;
+  for(const auto& example : utility::SvmlightReader<int>(train_path, dim)) {
+    model->update(example.feature, example.label);
+  }
+
+  std::vector<Eigen::SparseVector<double>> sparse;
+  std::vector<Eigen::VectorXd> dense;
+  std::vector<int> labels;
+  for(const auto& example : utility::SvmlightReader<int>(test_path, dim)) {
+    sparse.push_back(example.feature);
+    dense.push_back(Eigen::VectorXd(example.feature));
+    labels.push_back(example.label);
+  }
+
+  const QuantizedModel int8(*model, QuantizedType::Int8, block);
+  const QuantizedModel half(*model, QuantizedType::Float16, block);
+  if(!output.empty()) {
+    int8.save(output + ".q8");
+    half.save(output + ".f16");
+  }
+
+  const auto all = labels.size();
+  const auto weights = model->inference_weights();
+  const auto full_sparse = evaluate(*model, sparse, labels);
+  const auto full_dense = evaluate(*model, dense, labels);
+  std::cout << "model\tbytes\taccuracy\tdelta\tagreement\tsparse ns/predict\tdense ns/predict" << std::endl;
+  std::cout << "full\t" << weights.size() * sizeof(double) << "\t"
+            << (100.0 * full_sparse.first / all) << "%\t-\t-\t"
+            << full_sparse.second << "\t" << full_dense.second << std::endl;
+
+  for(const auto quantized : {&int8, &half}) {
+    const auto quantized_sparse = evaluate(*quantized, sparse, labels);
+    const auto quantized_dense = evaluate(*quantized, dense, labels);
+    auto agree = 0;
+    for(const auto& feature : dense) {
+      if(quantized->predict(feature) == model->predict(feature)) { ++agree; }
+    }
+    std::cout << (quantized->type() == QuantizedType::Int8 ? "int8" : "fp16") << "\t"
+              << quantized->bytes() << "\t"
+              << (100.0 * quantized_dense.first / all) << "%\t"
+              << (100.0 * (static_cast<int>(quantized_dense.first) - full_dense.first) / all) << "%\t"
+              << (100.0 * agree / all) << "%\t"
+              << quantized_sparse.second << "\t" << quantized_dense.second << std::endl;
+    std::cout << "  max |w - dequantized| = " << (weights - quantized->dequantize()).cwiseAbs().maxCoeff() << std::endl;
+  }
+
+  return 0;
+}
@@ -27,24 +27,18 @@ int main(const int ac, const char* const * const av) {
   const auto c = vm["c"].as<double>();
   const auto eta = vm["eta"].as<double>();
 
-  std::string line;
-  std::ifstream train_data(train_path);
-
   SCW scw(dim, c, eta);
   std::cout << "training..." << std::endl;
-  while(std::getline(train_data, line)) {
-    auto data = utility::read_ones<int>(line, dim);
-    scw.update(data.second, data.first);
+  for(const auto& example : utility::SvmlightReader<int>(train_path, dim)) {
+    scw.update(example.feature, example.label);
   }
 
   int collect = 0;
   int all = 0;
-  std::ifstream test_data(test_path);
   std::cout << "predicting..." << std::endl;
-  while(std::getline(test_data, line)) {
-    auto data = utility::read_ones<int>(line, dim);
-    int pred = scw.predict(data.second);
-    if(pred == data.first) {
+  for(const auto& example : utility::SvmlightReader<int>(test_path, dim)) {
+    int pred = scw.predict(example.feature);
+    if(pred == example.label) {
       ++collect;
     }
     ++all;
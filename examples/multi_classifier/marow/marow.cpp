@@ -13,6 +13,7 @@ int main(const int ac, const char* const * const av) {
     ("class", value<std::size_t>()->default_value(0), "クラス数")
     ("train", value<std::string>()->default_value(""), "学習データのファイルパス")
     ("test", value<std::string>()->default_value(""), "評価データのファイルパス")
+    ("threads", value<std::size_t>()->default_value(2), "パースに使うスレッド数")
     ("r", value<double>()->default_value(0.5), "ハイパパラメータ(r)");
 
   variables_map vm;
@@ -25,27 +26,22 @@ int main(const int ac, const char* const * const av) {
   const auto n_class = vm["class"].as<std::size_t>();
   const auto train_path = vm["train"].as<std::string>();
   const auto test_path = vm["test"].as<std::string>();
+  const auto n_threads = vm["threads"].as<std::size_t>();
   const auto r = vm["r"].as<double>();
 
-  std::string line;
-  std::ifstream train_data(train_path);
-
   MAROW marow(dim, n_class, r);
 
   std::cout << "training..." << std::endl;
-  while(std::getline(train_data, line)) {
-    auto data = utility::read_ones<std::size_t>(line, dim);
-    marow.update(data.second, data.first);
+  for(const auto& example : utility::ParallelSvmlightReader<std::size_t>(train_path, dim, n_threads)) {
+    marow.update(example.feature, example.label);
   }
 
   int collect = 0;
   int all = 0;
-  std::ifstream test_data(test_path);
   std::cout << "predicting..." << std::endl;
-  while(std::getline(test_data, line)) {
-    auto data = utility::read_ones<std::size_t>(line, dim);
-    auto pred = marow.predict(data.second);
-    if(pred == data.first) {
+  for(const auto& example : utility::ParallelSvmlightReader<std::size_t>(test_path, dim, n_threads)) {
+    auto pred = marow.predict(example.feature);
+    if(pred == example.label) {
       ++collect;
     }
     ++all;
@@ -13,6 +13,7 @@ int main(const int ac, const char* const * const av) {
     ("class", value<std::size_t>()->default_value(0), "クラス数")
     ("train", value<std::string>()->default_value(""), "学習データのファイルパス")
     ("test", value<std::string>()->default_value(""), "評価データのファイルパス")
+    ("threads", value<std::size_t>()->default_value(2), "パースに使うスレッド数")
     ("c", value<double>()->default_value(0.5), "ハイパパラメータ(C)")
     ("diagonal", value<int>()->default_value(0), "Diagonal Covariance, 0:Full 1:Exact 2:Project 3:Drop");
 
@@ -26,27 +27,22 @@ int main(const int ac, const char* const * const av) {
   const auto n_class = vm["class"].as<std::size_t>();
   const auto train_path = vm["train"].as<std::string>();
   const auto test_path = vm["test"].as<std::string>();
+  const auto n_threads = vm["threads"].as<std::size_t>();
   const auto c = vm["c"].as<double>();
   const auto diagonal = vm["diagonal"].as<int>();
 
-  std::string line;
-  std::ifstream train_data(train_path);
-
   MNHERD mnherd(dim, n_class, c, diagonal);
   std::cout << "training..." << std::endl;
-  while(std::getline(train_data, line)) {
-    auto data = utility::read_ones<std::size_t>(line, dim);
-    mnherd.update(data.second, data.first);
+  for(const auto& example : utility::ParallelSvmlightReader<std::size_t>(train_path, dim, n_threads)) {
+    mnherd.update(example.feature, example.label);
   }
 
   int collect = 0;
   int all = 0;
-  std::ifstream test_data(test_path);
   std::cout << "predicting..." << std::endl;
-  while(std::getline(test_data, line)) {
-    auto data = utility::read_ones<std::size_t>(line, dim);
-    auto pred = mnherd.predict(data.second);
-    if(pred == data.first) {
+  for(const auto& example : utility::ParallelSvmlightReader<std::size_t>(test_path, dim, n_threads)) {
+    auto pred = mnherd.predict(example.feature);
+    if(pred == example.label) {
       ++collect;
     }
     ++all;
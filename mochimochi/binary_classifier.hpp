@@ -7,5 +7,6 @@
 #include "./classifier/binary/pa.hpp"
 #include "./classifier/binary/adam.hpp"
 #include "./classifier/binary/adagrad_rda.hpp"
+#include "./classifier/binary/quantized_model.hpp"
 
 #endif //MOCHIMOCHI_BINARY_CLASSIFIER_HPP_
@@ -2,55 +2,170 @@
 #define MOCHIMOCHI_ADAGRAD_RDA_HPP_
 
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/nvp.hpp>
 #include <boost/serialization/split_member.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
+#include <algorithm>
 #include <fstream>
+#include <vector>
+#include "../../functions/dot.hpp"
 #include "../../functions/enumerate.hpp"
 #include "../factory/binary_oml.hpp"
 
-class ADAGRAD_RDA : public BinaryOML {
+/**
+ * ADAGRAD_RDA with its accumulators stored as ScalarT (ADAGRAD_RDA or ADAGRAD_RDAf).
+ *
+ * With batch_size B > 1, update() accumulates the hinge loss gradients of B examples and
+ * adds their mean to g and h as one timestep, as ADAM does. flush() applies a partial
+ * batch; save() flushes first.
+ */
+template <typename ScalarT>
+class BasicADAGRAD_RDA : public BinaryOML {
+public :
+  using Vector = Eigen::Matrix<ScalarT, Eigen::Dynamic, 1>;
+
 private :
   const std::size_t kDim;
   const double kEta;
   const double kLambda;
+  const std::size_t kBatchSize;
 
 private :
   std::size_t _timestep;
-  Eigen::VectorXd _w;
-  Eigen::VectorXd _h;
-  Eigen::VectorXd _g;
+  Vector _h;
+  Vector _g;
+  Vector _scale;
+  Vector _w;
+  std::size_t _materialized;
+
+  // Mini-batch state, only allocated when batch_size > 1.
+  Eigen::VectorXd _gradients;
+  std::vector<std::size_t> _touched;
+  std::size_t _pending;
+  bool _dense_batch;
 
 public :
-  ADAGRAD_RDA(const std::size_t dim, const double eta, const double lambda)
+  BasicADAGRAD_RDA(const std::size_t dim, const double eta, const double lambda, const std::size_t batch_size = 1)
     : kDim(dim),
       kEta(eta),
       kLambda(lambda),
+      kBatchSize(batch_size),
       _timestep(0),
-      _w(Eigen::VectorXd::Zero(kDim)),
-      _h(Eigen::VectorXd::Zero(kDim)),
-      _g(Eigen::VectorXd::Zero(kDim)) {
+      _h(Vector::Zero(kDim)),
+      _g(Vector::Zero(kDim)),
+      _scale(Vector::Zero(kDim)),
+      _w(Vector::Zero(kDim)),
+      _materialized(0),
+      _gradients(batch_size > 1 ? Eigen::VectorXd::Zero(kDim) : Eigen::VectorXd()),
+      _pending(0),
+      _dense_batch(false) {
     static_assert(std::numeric_limits<decltype(dim)>::max() > 0, "Dimension Error. (Dimension > 0)");
     static_assert(std::numeric_limits<decltype(eta)>::max() > 0, "Hyper Parameter Error. (eta > 0)");
     static_assert(std::numeric_limits<decltype(lambda)>::max() > 0, "Hyper Parameter Error. (lambda > 0)");
     assert(dim > 0);
     assert(eta > 0);
     assert(lambda > 0);
+    assert(batch_size > 0);
   }
 
-  virtual ~ADAGRAD_RDA() { }
+  virtual ~BasicADAGRAD_RDA() { }
 
 private :
 
+  // The RDA weight is a pure function of g, h and the timestep t:
+  //   w = 0                                 if |g| <= λt
+  //   w = η / sqrt(h) * (λt sign(g) - g)    otherwise
+  // that is w = -η / sqrt(h) * (g - clamp(g, -λt, λt)), so it is computed without branches
+  // when it is read instead of being stored. An update only touches g, h and the cached
+  // scale η / sqrt(h) of the non-zero coordinates, and the weights read are always those of
+  // the current timestep. materialize() stores a snapshot that predict() uses with a plain
+  // dot product until the next update.
+  ScalarT weight(const std::size_t index) const {
+    const ScalarT threshold = kLambda * _timestep;
+    const auto g = _g[index];
+    return -_scale[index] * (g - std::min(std::max(g, -threshold), threshold));
+  }
+
+  // All the weights as a (vectorized) Eigen expression.
+  auto weights() const {
+    const ScalarT threshold = kLambda * _timestep;
+    return -_scale.cwiseProduct(_g - _g.cwiseMax(-threshold).cwiseMin(threshold));
+  }
+
+  bool is_materialized() const {
+    return _materialized == _timestep;
+  }
+
   double calculate_margin(const Eigen::VectorXd& x) const {
-    return _w.dot(x);
+    return is_materialized() ? functions::dot(x, _w) : functions::dot(x, weights());
+  }
+
+  double calculate_margin(const Eigen::SparseVector<double>& x) const {
+    if (is_materialized()) { return functions::dot(x, _w); }
+
+    auto margin = 0.0;
+    functions::enumerate(x,
+                         [&](const std::size_t index, const double value) {
+                           margin += value * weight(index);
+                         });
+    return margin;
+  }
+
+  // weights()[i] is computed per coordinate, so a CSR batch only reads the stored ones.
+  Eigen::VectorXd batch_margins(const Eigen::MatrixXd& X) const override {
+    return is_materialized() ? functions::dot_rows(X, _w) : functions::dot_rows(X, weights());
+  }
+
+  Eigen::VectorXd batch_margins(const CsrMatrix& X) const override {
+    return is_materialized() ? functions::dot_rows(X, _w) : functions::dot_rows(X, weights());
+  }
+
+  template <typename FeatureT>
+  double suffer_loss(const FeatureT& x, const int y) const {
+    return std::max(0.0, 1.0 - y * calculate_margin(x));
+  }
+
+  void add_gradiant(const std::size_t index, const double gradiant) {
+    _g[index] += gradiant;
+    _h[index] += gradiant * gradiant;
+    _scale[index] = kEta / std::sqrt(_h[index]);
+  }
+
+  void accumulate(const Eigen::VectorXd& feature, const int label) {
+    _gradients.noalias() -= label * feature;
+    _dense_batch = true;
   }
 
-  double suffer_loss(const Eigen::VectorXd& x, const int y) const {
-    return std::max(0.0, 1.0 - y * _w.dot(x));
+  void accumulate(const Eigen::SparseVector<double>& feature, const int label) {
+    functions::enumerate(feature,
+                         [&](const std::size_t index, const double value) {
+                           _gradients[index] -= label * value;
+                           _touched.push_back(index);
+                         });
+  }
+
+  template <typename FeatureT>
+  bool update_with(const FeatureT& feature, const int label) {
+    const auto violated = suffer_loss(feature, label) > 0.0;
+
+    if (kBatchSize == 1) {
+      if (!violated) { return false; }
+      _timestep++;
+      functions::enumerate(feature,
+                           [&](const std::size_t index, const double value) {
+                             if (value == 0.0) { return; }
+                             add_gradiant(index, -label * value);
+                           });
+      return true;
+    }
+
+    if (violated) { accumulate(feature, label); }
+    if (++_pending == kBatchSize) { flush(); }
+    return violated;
   }
 
 public :
@@ -60,29 +175,75 @@ public :
   }
 
   bool update(const Eigen::VectorXd& feature, const int label) override {
-    if (suffer_loss(feature, label) <= 0.0) { return false; }
-
-    _timestep++;
-    functions::enumerate(feature.data(), feature.data() + feature.size(), 0,
-                       [&](const int index, const double value) {
-                         const auto gradiant = -label * value;
-                         _g[index] += gradiant;
-                         _h[index] += gradiant * gradiant;
-
-                         const auto sign = _g[index] >= 0 ? 1 : -1;
-                         const auto eta = kEta / std::sqrt(_h[index]);
-                         const auto u = std::abs(_g[index]) / _timestep;
+    return update_with(feature, label);
+  }
 
-                         _w[index] = (u <= kLambda) ? 0.0 : -sign * eta * _timestep * (u - kLambda);
-                       });
-    return true;
+  bool update(const Eigen::SparseVector<double>& feature, const int label) override {
+    return update_with(feature, label);
   }
 
   int predict(const Eigen::VectorXd& x) const override {
     return calculate_margin(x) > 0.0 ? 1 : -1;
   }
 
+  int predict(const Eigen::SparseVector<double>& x) const override {
+    return calculate_margin(x) > 0.0 ? 1 : -1;
+  }
+
+  /**
+   * Snapshot of the weights at the current timestep, for serving with a plain dot product.
+   * It is also kept by the model, so predict() skips computing the weights until the next
+   * update. The L1 regularization keeps most weights at zero, which materialize_sparse()
+   * takes advantage of.
+   */
+  const Vector& materialize(void) {
+    if (!is_materialized()) {
+      _w = weights();
+      _materialized = _timestep;
+    }
+    return _w;
+  }
+
+  Eigen::SparseVector<ScalarT> materialize_sparse(void) const {
+    Eigen::SparseVector<ScalarT> w(kDim);
+    for (std::size_t i = 0; i < kDim; ++i) {
+      const auto value = weight(i);
+      if (value != 0.0) { w.insertBack(i) = value; }
+    }
+    return w;
+  }
+
+  Eigen::VectorXd inference_weights(void) const override {
+    return weights().template cast<double>();
+  }
+
+  void flush(void) override {
+    if (_pending == 0) { return; }
+
+    const auto scale = 1.0 / _pending;
+    if (_dense_batch) {
+      _timestep++;
+      for (std::size_t i = 0; i < kDim; ++i) {
+        if (_gradients[i] != 0.0) { add_gradiant(i, _gradients[i] * scale); }
+      }
+      _gradients.setZero();
+    } else if (!_touched.empty()) {
+      std::sort(_touched.begin(), _touched.end());
+      _touched.erase(std::unique(_touched.begin(), _touched.end()), _touched.end());
+      _timestep++;
+      for (const auto i : _touched) {
+        if (_gradients[i] != 0.0) { add_gradiant(i, _gradients[i] * scale); }
+        _gradients[i] = 0.0;
+      }
+    }
+
+    _touched.clear();
+    _pending = 0;
+    _dense_batch = false;
+  }
+
   void save(const std::string& filename) override {
+    flush();
     std::ofstream ofs(filename);
     assert(ofs);
     boost::archive::text_oarchive oa(ofs);
@@ -103,9 +264,11 @@ private :
   BOOST_SERIALIZATION_SPLIT_MEMBER();
   template <class Archive>
   void save(Archive& ar, const unsigned int version) const {
-    std::vector<double> w_vector(_w.data(), _w.data() + _w.size());
-    std::vector<double> h_vector(_h.data(), _h.data() + _h.size());
-    std::vector<double> g_vector(_g.data(), _g.data() + _g.size());
+    // w is not needed to restore the model but is kept in the file for its readers
+    const Vector w = weights();
+    std::vector<ScalarT> w_vector(w.data(), w.data() + w.size());
+    std::vector<ScalarT> h_vector(_h.data(), _h.data() + _h.size());
+    std::vector<ScalarT> g_vector(_g.data(), _g.data() + _g.size());
 
     ar & boost::serialization::make_nvp("w", w_vector);
     ar & boost::serialization::make_nvp("h", h_vector);
@@ -118,9 +281,9 @@ private :
 
   template <class Archive>
   void load(Archive& ar, const unsigned int version) {
-    std::vector<double> w_vector;
-    std::vector<double> h_vector;
-    std::vector<double> g_vector;
+    std::vector<ScalarT> w_vector;
+    std::vector<ScalarT> h_vector;
+    std::vector<ScalarT> g_vector;
 
     ar & boost::serialization::make_nvp("w", w_vector);
     ar & boost::serialization::make_nvp("h", h_vector);
@@ -130,11 +293,23 @@ private :
     ar & boost::serialization::make_nvp("lambda", const_cast<double&>(kLambda));
     ar & boost::serialization::make_nvp("timestep", _timestep);
 
-    _w = Eigen::Map<Eigen::VectorXd>(&w_vector[0], w_vector.size());
-    _h = Eigen::Map<Eigen::VectorXd>(&h_vector[0], h_vector.size());
-    _g = Eigen::Map<Eigen::VectorXd>(&g_vector[0], g_vector.size());
+    _h = Eigen::Map<Vector>(&h_vector[0], h_vector.size());
+    _g = Eigen::Map<Vector>(&g_vector[0], g_vector.size());
+    _scale = (_h.array() > ScalarT(0)).select(ScalarT(kEta) / _h.array().sqrt(), ScalarT(0)).matrix();
+    _w = weights();
+    _materialized = _timestep;
+
+    // The partial mini-batch of the previous model is dropped, and the gradient buffer is
+    // sized to the loaded dimension.
+    _gradients = kBatchSize > 1 ? Eigen::VectorXd::Zero(kDim) : Eigen::VectorXd();
+    _touched.clear();
+    _pending = 0;
+    _dense_batch = false;
   }
 
 };
 
+using ADAGRAD_RDA = BasicADAGRAD_RDA<double>;
+using ADAGRAD_RDAf = BasicADAGRAD_RDA<float>;
+
 #endif //MOCHIMOCHI_ADAGRAD_RDA_HPP_
@@ -2,6 +2,7 @@
 #define MOCHIMOCHI_ADAM_HPP_
 
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 #include <cassert>
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/nvp.hpp>
@@ -9,79 +10,215 @@
 #include <boost/serialization/vector.hpp>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
+#include <boost/serialization/version.hpp>
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <vector>
+#include "../../functions/dot.hpp"
 #include "../../functions/enumerate.hpp"
 #include "../factory/binary_oml.hpp"
 
-class ADAM : public BinaryOML {
+/**
+ * ADAM with its weights and moments stored as ScalarT (ADAM or ADAMf). The step sizes are
+ * computed in double.
+ *
+ * With batch_size B > 1, update() accumulates the hinge loss gradients of B examples, all
+ * evaluated against the same weights, and applies one ADAM step with their mean. Only the
+ * examples with a loss contribute, but every example counts towards B. flush() applies a
+ * partial batch; save() flushes first.
+ */
+template <typename ScalarT>
+class BasicADAM : public BinaryOML {
+public :
+  using Vector = Eigen::Matrix<ScalarT, Eigen::Dynamic, 1>;
+
 private :
   const std::size_t kDim;
+  const std::size_t kBatchSize;
 
 private :
   std::size_t _timestep;
-  Eigen::VectorXd _w;
-  Eigen::VectorXd _m;
-  Eigen::VectorXd _v;
+  Vector _w;
+  Vector _m;
+  Vector _v;
+  std::vector<std::size_t> _timestamps;
+
+  // Mini-batch state, only allocated when batch_size > 1.
+  Eigen::VectorXd _gradients;
+  std::vector<std::size_t> _touched;
+  std::size_t _pending;
+  bool _dense_batch;
 
 public :
-  ADAM(const std::size_t dim)
+  BasicADAM(const std::size_t dim, const std::size_t batch_size = 1)
     : kDim(dim),
+      kBatchSize(batch_size),
       _timestep(0),
-      _w(Eigen::VectorXd::Zero(kDim)),
-      _m(Eigen::VectorXd::Zero(kDim)),
-      _v(Eigen::VectorXd::Zero(kDim)) {
+      _w(Vector::Zero(kDim)),
+      _m(Vector::Zero(kDim)),
+      _v(Vector::Zero(kDim)),
+      _timestamps(kDim, 0),
+      _gradients(batch_size > 1 ? Eigen::VectorXd::Zero(kDim) : Eigen::VectorXd()),
+      _pending(0),
+      _dense_batch(false) {
 
     assert(dim > 0);
+    assert(batch_size > 0);
   }
 
-  virtual ~ADAM() { }
+  virtual ~BasicADAM() { }
 
 private :
 
-  double suffer_loss(const Eigen::VectorXd& x, const int y) const {
-    return std::max(0.0, 1.0 - y * _w.dot(x));
+  template <typename FeatureT>
+  double suffer_loss(const FeatureT& x, const int y) const {
+    return std::max(0.0, 1.0 - y * functions::dot(x, _w));
   }
 
-  double calculate_margin(const Eigen::VectorXd& x) const {
-    return _w.dot(x);
+  template <typename FeatureT>
+  double calculate_margin(const FeatureT& x) const {
+    return functions::dot(x, _w);
   }
 
-public :
+  Eigen::VectorXd batch_margins(const Eigen::MatrixXd& X) const override {
+    return functions::dot_rows(X, _w);
+  }
 
-  std::string name() const override {
-    return std::string("ADAM");
+  Eigen::VectorXd batch_margins(const CsrMatrix& X) const override {
+    return functions::dot_rows(X, _w);
   }
 
-  bool update(const Eigen::VectorXd& feature, const int label) override {
+  // With a sparse feature only the stored coordinates are visited (lazy ADAM), so an update
+  // costs O(nnz). _timestamps[i] is the last step at which coordinate i was updated; when it
+  // reappears, the decay of its moments over the skipped steps s+1..t-1 is applied in closed
+  // form:
+  //   m *= Π β1 λ^(k-1) = β1^n λ^(n (s + t - 2) / 2),  v *= β2^n,  with n = t - 1 - s.
+  // The weight itself is not moved on the skipped steps. A dense feature visits every
+  // coordinate at every step and is the exact ADAM update.
+  //
+  // visit(f) calls f(index, gradiant) for each coordinate taking part in the step.
+  template <typename VisitT>
+  void step(VisitT visit) {
     constexpr auto kAlpha = 0.001;
     constexpr auto kBeta1 = 0.9;
     constexpr auto kBeta2 = 0.999;
     constexpr auto kEpsilon = 0.00000001;
     constexpr auto kLambda = 0.99999999;
 
-    if (suffer_loss(feature, label) <= 0.0) { return false; }
-
-    const Eigen::VectorXd gradiant = -label * feature;
     const auto beta1_t = std::pow(kLambda, _timestep) * kBeta1;
 
     _timestep++;
-    functions::enumerate(gradiant.data(), gradiant.data() + gradiant.size(), 0,
-                       [&](const std::size_t index, const double value) {
-                         _m[index] = beta1_t * _m[index] + (1.0 - beta1_t) * value;
-                         _v[index] = kBeta2 * _v[index] + (1.0 - kBeta2) * value * value;
-                         const auto m_t = _m[index] / (1.0 - std::pow(kBeta1, _timestep));
-                         const auto v_t = _v[index] / (1.0 - std::pow(kBeta2, _timestep));
-                         _w[index] -= kAlpha * m_t / (std::sqrt(v_t) + kEpsilon);
-                       });
+    const auto t = _timestep;
+    const auto bias1 = 1.0 - std::pow(kBeta1, t);
+    const auto bias2 = 1.0 - std::pow(kBeta2, t);
+    const auto log_beta1 = std::log(kBeta1);
+    const auto log_beta2 = std::log(kBeta2);
+    const auto log_lambda = std::log(kLambda);
+
+    visit([&](const std::size_t index, const double gradiant) {
+        const auto s = _timestamps[index];
+        if (s + 1 < t) {
+          const auto n = static_cast<double>(t - 1 - s);
+          _m[index] *= std::exp(n * log_beta1 + 0.5 * n * (s + t - 2) * log_lambda);
+          _v[index] *= std::exp(n * log_beta2);
+        }
+        _timestamps[index] = t;
+
+        _m[index] = beta1_t * _m[index] + (1.0 - beta1_t) * gradiant;
+        _v[index] = kBeta2 * _v[index] + (1.0 - kBeta2) * gradiant * gradiant;
+        const auto m_t = _m[index] / bias1;
+        const auto v_t = _v[index] / bias2;
+        _w[index] -= kAlpha * m_t / (std::sqrt(v_t) + kEpsilon);
+      });
+  }
+
+  // A dense feature makes the whole mini-batch step dense; a sparse one only records the
+  // coordinates it touches.
+  void accumulate(const Eigen::VectorXd& feature, const int label) {
+    _gradients.noalias() -= label * feature;
+    _dense_batch = true;
+  }
 
-    return true;
+  void accumulate(const Eigen::SparseVector<double>& feature, const int label) {
+    functions::enumerate(feature,
+                         [&](const std::size_t index, const double value) {
+                           _gradients[index] -= label * value;
+                           _touched.push_back(index);
+                         });
+  }
+
+  template <typename FeatureT>
+  bool update_with(const FeatureT& feature, const int label) {
+    const auto violated = suffer_loss(feature, label) > 0.0;
+
+    if (kBatchSize == 1) {
+      if (!violated) { return false; }
+      step([&](auto apply) {
+          functions::enumerate(feature,
+                               [&](const std::size_t index, const double value) {
+                                 apply(index, -label * value);
+                               });
+        });
+      return true;
+    }
+
+    if (violated) { accumulate(feature, label); }
+    if (++_pending == kBatchSize) { flush(); }
+    return violated;
+  }
+
+public :
+
+  std::string name() const override {
+    return std::string("ADAM");
+  }
+
+  bool update(const Eigen::VectorXd& feature, const int label) override {
+    return update_with(feature, label);
+  }
+
+  bool update(const Eigen::SparseVector<double>& feature, const int label) override {
+    return update_with(feature, label);
   }
 
   int predict(const Eigen::VectorXd& feature) const override {
     return calculate_margin(feature) > 0.0 ? 1 : -1;
   }
 
+  int predict(const Eigen::SparseVector<double>& feature) const override {
+    return calculate_margin(feature) > 0.0 ? 1 : -1;
+  }
+
+  Eigen::VectorXd inference_weights(void) const override {
+    return _w.template cast<double>();
+  }
+
+  void flush(void) override {
+    if (_pending == 0) { return; }
+
+    const auto scale = 1.0 / _pending;
+    if (_dense_batch) {
+      step([&](auto apply) {
+          for (std::size_t i = 0; i < kDim; ++i) { apply(i, _gradients[i] * scale); }
+        });
+      _gradients.setZero();
+    } else if (!_touched.empty()) {
+      std::sort(_touched.begin(), _touched.end());
+      _touched.erase(std::unique(_touched.begin(), _touched.end()), _touched.end());
+      step([&](auto apply) {
+          for (const auto i : _touched) { apply(i, _gradients[i] * scale); }
+        });
+      for (const auto i : _touched) { _gradients[i] = 0.0; }
+    }
+
+    _touched.clear();
+    _pending = 0;
+    _dense_batch = false;
+  }
+
   void save(const std::string& filename) override {
+    flush();
     std::ofstream ofs(filename);
     assert(ofs);
     boost::archive::text_oarchive oa(ofs);
@@ -102,32 +239,64 @@ private :
   BOOST_SERIALIZATION_SPLIT_MEMBER();
   template <class Archive>
   void save(Archive& ar, const unsigned int version) const {
-    std::vector<double> w_vector(_w.data(), _w.data() + _w.size());
-    std::vector<double> m_vector(_m.data(), _m.data() + _m.size());
-    std::vector<double> v_vector(_v.data(), _v.data() + _v.size());
+    std::vector<ScalarT> w_vector(_w.data(), _w.data() + _w.size());
+    std::vector<ScalarT> m_vector(_m.data(), _m.data() + _m.size());
+    std::vector<ScalarT> v_vector(_v.data(), _v.data() + _v.size());
 
     ar & boost::serialization::make_nvp("w", w_vector);
     ar & boost::serialization::make_nvp("m", m_vector);
     ar & boost::serialization::make_nvp("v", v_vector);
     ar & boost::serialization::make_nvp("dimension", const_cast<std::size_t&>(kDim));
+    ar & boost::serialization::make_nvp("timestep", const_cast<std::size_t&>(_timestep));
+    ar & boost::serialization::make_nvp("timestamps", const_cast<std::vector<std::size_t>&>(_timestamps));
   }
 
   template <class Archive>
   void load(Archive& ar, const unsigned int version) {
-    std::vector<double> w_vector;
-    std::vector<double> m_vector;
-    std::vector<double> v_vector;
+    std::vector<ScalarT> w_vector;
+    std::vector<ScalarT> m_vector;
+    std::vector<ScalarT> v_vector;
 
     ar & boost::serialization::make_nvp("w", w_vector);
     ar & boost::serialization::make_nvp("m", m_vector);
     ar & boost::serialization::make_nvp("v", v_vector);
     ar & boost::serialization::make_nvp("dimension", const_cast<std::size_t&>(kDim));
 
-    _w = Eigen::Map<Eigen::VectorXd>(&w_vector[0], w_vector.size());
-    _m = Eigen::Map<Eigen::VectorXd>(&m_vector[0], m_vector.size());
-    _v = Eigen::Map<Eigen::VectorXd>(&v_vector[0], v_vector.size());
+    // version 0 models were saved without the step counters
+    _timestep = 0;
+    _timestamps.assign(w_vector.size(), 0);
+    if (version > 0) {
+      ar & boost::serialization::make_nvp("timestep", _timestep);
+      ar & boost::serialization::make_nvp("timestamps", _timestamps);
+    }
+
+    _w = Eigen::Map<Vector>(&w_vector[0], w_vector.size());
+    _m = Eigen::Map<Vector>(&m_vector[0], m_vector.size());
+    _v = Eigen::Map<Vector>(&v_vector[0], v_vector.size());
+
+    // The partial mini-batch of the previous model is dropped, and the gradient buffer is
+    // sized to the loaded dimension.
+    _gradients = kBatchSize > 1 ? Eigen::VectorXd::Zero(kDim) : Eigen::VectorXd();
+    _touched.clear();
+    _pending = 0;
+    _dense_batch = false;
   }
 
 };
 
+// BOOST_CLASS_VERSION(BasicADAM<ScalarT>, 1), which the macro cannot spell for a template.
+namespace boost {
+  namespace serialization {
+    template <typename ScalarT>
+    struct version<BasicADAM<ScalarT>> {
+      typedef mpl::int_<1> type;
+      typedef mpl::integral_c_tag tag;
+      BOOST_STATIC_CONSTANT(int, value = version::type::value);
+    };
+  }
+}
+
+using ADAM = BasicADAM<double>;
+using ADAMf = BasicADAM<float>;
+
 #endif //MOCHIMOCHI_ADAM_HPP_
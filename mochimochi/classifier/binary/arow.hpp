@@ -2,6 +2,7 @@
 #define MOCHIMOCHI_AROW_HPP_
 
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/nvp.hpp>
 #include <boost/serialization/split_member.hpp>
@@ -9,24 +10,52 @@
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 #include <fstream>
-#include "../../functions/enumerate.hpp"
+#include "../../functions/dot.hpp"
+#include "../../functions/fused.hpp"
 #include "../factory/binary_oml.hpp"
 
-class AROW : public BinaryOML {
+// The AROW update on a mean and covariance vector of any scalar type, which may also be the
+// rows of a multi-class model (ClassMatrix::Row).
+namespace arow {
+  template <typename FeatureT, typename VectorT>
+  bool update(const FeatureT& feature, const int label, VectorT& means, VectorT& covariances, const double r) {
+    // Most examples stop at the margin check, so the covariances are only read on a violation.
+    const auto margin = functions::dot(feature, means);
+
+    if (margin * label >= 1.0) { return false; }
+
+    const auto confidence = functions::confidence(feature, covariances);
+    const auto beta = 1.0 / (confidence + r);
+    const auto alpha = std::max(0.0, 1.0 - label * margin) * beta;
+
+    functions::update_means_and_covariances(feature, means, covariances, alpha * label, beta);
+    return true;
+  }
+};
+
+/**
+ * AROW with its means and covariances stored as ScalarT: AROW (double) or AROWf (float),
+ * which halves the memory of a model. Features, margins and hyper parameters stay double.
+ */
+template <typename ScalarT>
+class BasicAROW : public BinaryOML {
+public :
+  using Vector = Eigen::Matrix<ScalarT, Eigen::Dynamic, 1>;
+
 private :
   const std::size_t kDim;
   const double kR;
 
 private :
-  Eigen::VectorXd _covariances;
-  Eigen::VectorXd _means;
+  Vector _covariances;
+  Vector _means;
 
 public :
-  AROW(const std::size_t dim, const double r)
+  BasicAROW(const std::size_t dim, const double r)
     : kDim(dim),
       kR(r),
-      _covariances(Eigen::VectorXd::Ones(kDim)),
-      _means(Eigen::VectorXd::Zero(kDim)) {
+      _covariances(Vector::Ones(kDim)),
+      _means(Vector::Zero(kDim)) {
 
     static_assert(std::numeric_limits<decltype(dim)>::max() > 0, "Dimension Error. (Dimension > 0)");
     static_assert(std::numeric_limits<decltype(r)>::max() > 0, "Hyper Parameter Error. (r > 0)");
@@ -35,25 +64,21 @@ public :
 
   }
 
-  virtual ~AROW() { }
+  virtual ~BasicAROW() { }
 
 private :
 
-  double suffer_loss(const double margin, const int label) const {
-    return margin * label;
+  template <typename FeatureT>
+  double compute_margin(const FeatureT& x) const {
+    return functions::dot(x, _means);
   }
 
-  double compute_margin(const Eigen::VectorXd& x) const {
-    return _means.dot(x);
+  Eigen::VectorXd batch_margins(const Eigen::MatrixXd& X) const override {
+    return functions::dot_rows(X, _means);
   }
 
-  double compute_confidence(const Eigen::VectorXd& feature) const {
-    auto confidence = 0.0;
-    functions::enumerate(feature.data(), feature.data() + feature.size(), 0,
-                         [&](const int index, const double value) {
-                           confidence += _covariances[index] * value * value;
-                         });
-    return confidence;
+  Eigen::VectorXd batch_margins(const CsrMatrix& X) const override {
+    return functions::dot_rows(X, _means);
   }
 
 public :
@@ -63,31 +88,29 @@ public :
   }
 
   bool update(const Eigen::VectorXd& feature, const int label) override {
-    const auto margin = compute_margin(feature);
-
-    if (suffer_loss(margin, label) >= 1.0) { return false; }
-
-    const auto confidence = compute_confidence(feature);
-    const auto beta = 1.0 / (confidence + kR);
-    const auto alpha = std::max(0.0, 1.0 - label * margin) * beta;
+    return arow::update(feature, label, _means, _covariances, kR);
+  }
 
-    functions::enumerate(feature.data(), feature.data() + feature.size(), 0,
-                         [&](const int index, const double value) {
-                           const auto v = _covariances[index] * value;
-                           _means[index] += alpha * label * v;
-                           _covariances[index] -= beta * v * v;
-                         });
-    return true;
+  bool update(const Eigen::SparseVector<double>& feature, const int label) override {
+    return arow::update(feature, label, _means, _covariances, kR);
   }
 
   int predict(const Eigen::VectorXd& x) const override {
     return compute_margin(x) > 0.0 ? 1 : -1;
   }
 
-  Eigen::VectorXd get_means(void) const {
+  int predict(const Eigen::SparseVector<double>& x) const override {
+    return compute_margin(x) > 0.0 ? 1 : -1;
+  }
+
+  Vector get_means(void) const {
     return _means;
   }
 
+  Eigen::VectorXd inference_weights(void) const override {
+    return _means.template cast<double>();
+  }
+
   void save(const std::string& filename) override {
     std::ofstream ofs(filename);
     assert(ofs);
@@ -109,8 +132,8 @@ private :
   BOOST_SERIALIZATION_SPLIT_MEMBER();
   template <class Archive>
   void save(Archive& ar, const unsigned int version) const {
-    std::vector<double> covariances_vector(_covariances.data(), _covariances.data() + _covariances.size());
-    std::vector<double> means_vector(_means.data(), _means.data() + _means.size());
+    std::vector<ScalarT> covariances_vector(_covariances.data(), _covariances.data() + _covariances.size());
+    std::vector<ScalarT> means_vector(_means.data(), _means.data() + _means.size());
     ar & boost::serialization::make_nvp("covariances", covariances_vector);
     ar & boost::serialization::make_nvp("means", means_vector);
     ar & boost::serialization::make_nvp("dimension", const_cast<std::size_t&>(kDim));
@@ -119,15 +142,18 @@ private :
 
   template <class Archive>
   void load(Archive& ar, const unsigned int version) {
-    std::vector<double> covariances_vector;
-    std::vector<double> means_vector;
+    std::vector<ScalarT> covariances_vector;
+    std::vector<ScalarT> means_vector;
     ar & boost::serialization::make_nvp("covariances", covariances_vector);
     ar & boost::serialization::make_nvp("means", means_vector);
     ar & boost::serialization::make_nvp("dimension", const_cast<std::size_t&>(kDim));
     ar & boost::serialization::make_nvp("r", const_cast<double&>(kR));
-    _covariances = Eigen::Map<Eigen::VectorXd>(&covariances_vector[0], covariances_vector.size());
-    _means = Eigen::Map<Eigen::VectorXd>(&means_vector[0], means_vector.size());
+    _covariances = Eigen::Map<Vector>(&covariances_vector[0], covariances_vector.size());
+    _means = Eigen::Map<Vector>(&means_vector[0], means_vector.size());
   }
 };
 
+using AROW = BasicAROW<double>;
+using AROWf = BasicAROW<float>;
+
 #endif //MOCHIMOCHI_AROW_HPP_
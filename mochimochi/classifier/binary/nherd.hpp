@@ -2,126 +2,198 @@
 #define MOCHIMOCHI_NHERD_HPP_
 
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/nvp.hpp>
 #include <boost/serialization/split_member.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
+#include <algorithm>
 #include <fstream>
-#include <functional>
+#include <stdexcept>
+#include "../../functions/dot.hpp"
 #include "../../functions/enumerate.hpp"
+#include "../../functions/fused.hpp"
 #include "../factory/binary_oml.hpp"
 
-class NHERD : public BinaryOML {
-private :
-  const std::size_t kDim;
-  const double kC;
-  const int kDiagonal;
+// The diagonal covariance modes, as policies of BasicNHERD. coefficient() holds what is
+// constant over one update (it only depends on C and the confidence of the example), so the
+// per-coordinate covariance() is a few multiplications and the update loop vectorizes.
+namespace nherd {
+  struct Full {
+    static constexpr int kDiagonal = 0;
 
-private :
-  Eigen::VectorXd _covariances;
-  Eigen::VectorXd _means;
+    static double coefficient(const double C, const double confidence) {
+      const auto denominator = 1.0 + C * confidence;
+      return (C * C * confidence + 2 * C) / (denominator * denominator);
+    }
 
-private :
-  std::function<double(double, double, double)> _compute_covariance;
+    static double covariance(const double covariance, const double value, const double, const double coefficient) {
+      const auto v = covariance * value;
+      return covariance - v * v * coefficient;
+    }
+  };
 
-public :
-  NHERD(const std::size_t dim, const double C, const int diagonal = 0)
-    : kDim(dim),
-      kC(C),
-      kDiagonal(diagonal),
-      _covariances(Eigen::VectorXd::Ones(kDim)),
-      _means(Eigen::VectorXd::Zero(kDim)) {
+  struct Exact {
+    static constexpr int kDiagonal = 1;
 
-    static_assert(std::numeric_limits<decltype(dim)>::max() > 0, "Dimension Error. (Dimension > 0)");
-    static_assert(std::numeric_limits<decltype(C)>::max() > 0, "Hyper Parameter Error. (C > 0)");
+    static double coefficient(const double, const double) {
+      return 0.0;
+    }
 
-    // int diagonal : switching the diagonal covariance
-    // 0 : Full covariance
-    // 1 : Exact covariance
-    // 2 : Project covariance
-    // 3 : Drop covariance
-    switch(kDiagonal) {
-    case 0 :
-      _compute_covariance = [=](const auto covariance, const auto confidence, const auto value) {
-        const auto v = covariance * value;
-        return covariance - (v * v * (kC * kC * confidence + 2 * kC) / std::pow((1.0 + kC * confidence), 2));
-      };
-      break;
-    case 1 :
-      _compute_covariance = [=](const auto covariance, const auto confidence, const auto value) {
-        return covariance / std::pow(1.0 + kC * value * value * covariance, 2);
-      };
-      break;
-    case 2 :
-      _compute_covariance = [=](const auto covariance, const auto confidence, const auto value) {
-        return 1.0 / ((1.0 / covariance) + (2 * kC + kC * kC * confidence) * value * value);
-      };
-      break;
-    case 3 :
-      _compute_covariance = [=](const auto covariance, const auto confidence, const auto value) {
-        const auto v = (std::pow(covariance * value, 2) * (kC * kC * confidence + 2 * kC) / std::pow(1.0 + kC * confidence, 2));
-        return covariance - v;
-      };
-      break;
-    default:
-      std::runtime_error("Error in switching the diagonal covariance.");
+    static double covariance(const double covariance, const double value, const double C, const double) {
+      const auto denominator = 1.0 + C * value * value * covariance;
+      return covariance / (denominator * denominator);
     }
+  };
 
-  }
+  struct Project {
+    static constexpr int kDiagonal = 2;
 
-  virtual ~NHERD() { }
+    static double coefficient(const double C, const double confidence) {
+      return 2 * C + C * C * confidence;
+    }
 
-private :
+    static double covariance(const double covariance, const double value, const double, const double coefficient) {
+      return 1.0 / ((1.0 / covariance) + coefficient * value * value);
+    }
+  };
 
-  double suffer_loss(const double margin, const int label) const {
-    return margin * label;
-  }
+  struct Drop {
+    static constexpr int kDiagonal = 3;
+
+    static double coefficient(const double C, const double confidence) {
+      return Full::coefficient(C, confidence);
+    }
+
+    static double covariance(const double covariance, const double value, const double C, const double coefficient) {
+      return Full::covariance(covariance, value, C, coefficient);
+    }
+  };
 
-  double compute_margin(const Eigen::VectorXd& x) const {
-    return _means.dot(x);
+  // The NHERD update with the covariance mode PolicyT on a mean and covariance vector of any
+  // scalar type, which may also be the rows of a multi-class model (ClassMatrix::Row).
+  template <typename PolicyT, typename VectorT>
+  void update_moments(const Eigen::VectorXd& feature, VectorT& means, VectorT& covariances,
+                      const double C, const double step, const double coefficient) {
+    const auto x = feature.data();
+    const auto m = means.data();
+    const auto s = covariances.data();
+    const auto n = feature.size();
+    for (auto i = decltype(n)(0); i < n; ++i) {
+      m[i] += step * s[i] * x[i];
+      s[i] = PolicyT::covariance(s[i], x[i], C, coefficient);
+    }
   }
 
-  double compute_confidence(const Eigen::VectorXd& feature) const {
-    auto confidence = 0.0;
-    functions::enumerate(feature.data(), feature.data() + feature.size(), 0,
-                         [&](const int index, const double value) {
-                           confidence += _covariances[index] * value * value;
+  template <typename PolicyT, typename VectorT>
+  void update_moments(const Eigen::SparseVector<double>& feature, VectorT& means, VectorT& covariances,
+                      const double C, const double step, const double coefficient) {
+    functions::enumerate(feature,
+                         [&](const std::size_t index, const double value) {
+                           means[index] += step * covariances[index] * value;
+                           covariances[index] = PolicyT::covariance(covariances[index], value, C, coefficient);
                          });
-    return confidence;
   }
 
+  template <typename PolicyT, typename FeatureT, typename VectorT>
+  bool update(const FeatureT& feature, const int label, VectorT& means, VectorT& covariances, const double C) {
+    // Most examples stop at the margin check, so the covariances are only read on a violation.
+    const auto margin = functions::dot(feature, means);
+
+    if (margin * label >= 1.0) { return false; }
+
+    const auto confidence = functions::confidence(feature, covariances);
+    const auto alpha = std::max(0.0, 1.0 - label * margin) / (confidence + 1 / C) ;
+
+    update_moments<PolicyT>(feature, means, covariances, C, alpha * label, PolicyT::coefficient(C, confidence));
+    return true;
+  }
+
+  // Calls f(PolicyT()) with the policy of the run-time mode diagonal.
+  template <typename FunctionT>
+  auto dispatch(const int diagonal, FunctionT f) {
+    switch(diagonal) {
+    case 0 :
+      return f(Full());
+    case 1 :
+      return f(Exact());
+    case 2 :
+      return f(Project());
+    default :
+      return f(Drop());
+    }
+  }
+};
+
+/**
+ * Means, covariances, prediction and serialization shared by BasicNHERD and DynamicNHERD,
+ * with the means and covariances stored as ScalarT. The file format does not depend on the
+ * class, so a model saved by one loads into the other.
+ */
+template <typename ScalarT>
+class NHERDBase : public BinaryOML {
 public :
+  using Vector = Eigen::Matrix<ScalarT, Eigen::Dynamic, 1>;
 
-  std::string name() const override {
-    return std::string("NHERD");
+protected :
+  const std::size_t kDim;
+  const double kC;
+  const int kDiagonal;
+
+protected :
+  Vector _covariances;
+  Vector _means;
+
+protected :
+  NHERDBase(const std::size_t dim, const double C, const int diagonal)
+    : kDim(dim),
+      kC(C),
+      kDiagonal(diagonal),
+      _covariances(Vector::Ones(kDim)),
+      _means(Vector::Zero(kDim)) {
+
+    static_assert(std::numeric_limits<decltype(dim)>::max() > 0, "Dimension Error. (Dimension > 0)");
+    static_assert(std::numeric_limits<decltype(C)>::max() > 0, "Hyper Parameter Error. (C > 0)");
   }
 
-  bool update(const Eigen::VectorXd& feature, const int label) override {
-    const auto margin = compute_margin(feature);
+public :
+  virtual ~NHERDBase() { }
 
-    if (suffer_loss(margin, label) >= 1.0) { return false; }
+protected :
 
-    const auto confidence = compute_confidence(feature);
-    const auto alpha = std::max(0.0, 1.0 - label * margin) / (confidence + 1 / kC) ;
+  template <typename FeatureT>
+  double compute_margin(const FeatureT& x) const {
+    return functions::dot(x, _means);
+  }
 
-    functions::enumerate(feature.data(), feature.data() + feature.size(), 0,
-                       [&](const std::size_t index, const double value) {
-                         _means[index] += alpha * label * _covariances[index] * value;
-                         _covariances[index] = _compute_covariance(_covariances[index], confidence, value);
-                       });
-    return true;
+  Eigen::VectorXd batch_margins(const Eigen::MatrixXd& X) const override {
+    return functions::dot_rows(X, _means);
   }
 
+  Eigen::VectorXd batch_margins(const CsrMatrix& X) const override {
+    return functions::dot_rows(X, _means);
+  }
+
+public :
+
   int predict(const Eigen::VectorXd& x) const override {
     return compute_margin(x) > 0.0 ? 1 : -1;
   }
 
-  Eigen::VectorXd get_means(void) const {
+  int predict(const Eigen::SparseVector<double>& x) const override {
+    return compute_margin(x) > 0.0 ? 1 : -1;
+  }
+
+  Vector get_means(void) const {
     return _means;
   }
 
+  Eigen::VectorXd inference_weights(void) const override {
+    return _means.template cast<double>();
+  }
+
   void save(const std::string& filename) override {
     std::ofstream ofs(filename);
     assert(ofs);
@@ -143,8 +215,8 @@ private :
   BOOST_SERIALIZATION_SPLIT_MEMBER();
   template <class Archive>
   void save(Archive& ar, const unsigned int version) const {
-    std::vector<double> covariances_vector(_covariances.data(), _covariances.data() + _covariances.size());
-    std::vector<double> means_vector(_means.data(), _means.data() + _means.size());
+    std::vector<ScalarT> covariances_vector(_covariances.data(), _covariances.data() + _covariances.size());
+    std::vector<ScalarT> means_vector(_means.data(), _means.data() + _means.size());
     ar & boost::serialization::make_nvp("covariances", covariances_vector);
     ar & boost::serialization::make_nvp("means", means_vector);
     ar & boost::serialization::make_nvp("dimension", const_cast<std::size_t&>(kDim));
@@ -154,16 +226,121 @@ private :
 
   template <class Archive>
   void load(Archive& ar, const unsigned int version) {
-    std::vector<double> covariances_vector;
-    std::vector<double> means_vector;
+    std::vector<ScalarT> covariances_vector;
+    std::vector<ScalarT> means_vector;
+    std::size_t dim;
+    double C;
+    int diagonal;
     ar & boost::serialization::make_nvp("covariances", covariances_vector);
     ar & boost::serialization::make_nvp("means", means_vector);
-    ar & boost::serialization::make_nvp("dimension", const_cast<std::size_t&>(kDim));
-    ar & boost::serialization::make_nvp("C", const_cast<double&>(kC));
-    ar & boost::serialization::make_nvp("diagonal", const_cast<int&>(kDiagonal));
-    _covariances = Eigen::Map<Eigen::VectorXd>(&covariances_vector[0], covariances_vector.size());
-    _means = Eigen::Map<Eigen::VectorXd>(&means_vector[0], means_vector.size());
+    ar & boost::serialization::make_nvp("dimension", dim);
+    ar & boost::serialization::make_nvp("C", C);
+    ar & boost::serialization::make_nvp("diagonal", diagonal);
+    check_diagonal(diagonal);
+
+    const_cast<std::size_t&>(kDim) = dim;
+    const_cast<double&>(kC) = C;
+    const_cast<int&>(kDiagonal) = diagonal;
+    _covariances = Eigen::Map<Vector>(&covariances_vector[0], covariances_vector.size());
+    _means = Eigen::Map<Vector>(&means_vector[0], means_vector.size());
+  }
+
+protected :
+  // Throws when a loaded model file has a covariance mode this class cannot train; the model
+  // is left as it was.
+  virtual void check_diagonal(const int diagonal) const = 0;
+};
+
+/**
+ * NHERD with the covariance mode chosen at compile time:
+ *
+ *   BasicNHERD<nherd::Project> nherd(dim, C);
+ *   BasicNHERD<nherd::Project, float> nherd32(dim, C);
+ */
+template <typename PolicyT, typename ScalarT = double>
+class BasicNHERD : public NHERDBase<ScalarT> {
+public :
+  BasicNHERD(const std::size_t dim, const double C)
+    : NHERDBase<ScalarT>(dim, C, PolicyT::kDiagonal) { }
+
+  virtual ~BasicNHERD() { }
+
+protected :
+  void check_diagonal(const int diagonal) const override {
+    if (diagonal != PolicyT::kDiagonal) {
+      throw std::runtime_error("The covariance mode of the model file does not match BasicNHERD.");
+    }
+  }
+
+public :
+
+  std::string name() const override {
+    return std::string("NHERD");
+  }
+
+  bool update(const Eigen::VectorXd& feature, const int label) override {
+    return nherd::update<PolicyT>(feature, label, this->_means, this->_covariances, this->kC);
+  }
+
+  bool update(const Eigen::SparseVector<double>& feature, const int label) override {
+    return nherd::update<PolicyT>(feature, label, this->_means, this->_covariances, this->kC);
   }
 };
 
+/**
+ * NHERD with the covariance mode chosen at run time (NHERD or NHERDf). The mode is
+ * dispatched once per update to the same kernels as BasicNHERD.
+ */
+template <typename ScalarT>
+class DynamicNHERD : public NHERDBase<ScalarT> {
+public :
+  DynamicNHERD(const std::size_t dim, const double C, const int diagonal = 0)
+    : NHERDBase<ScalarT>(dim, C, diagonal) {
+
+    // int diagonal : switching the diagonal covariance
+    // 0 : Full covariance
+    // 1 : Exact covariance
+    // 2 : Project covariance
+    // 3 : Drop covariance
+    if (diagonal < 0 || diagonal > 3) {
+      throw std::runtime_error("Error in switching the diagonal covariance.");
+    }
+  }
+
+  virtual ~DynamicNHERD() { }
+
+protected :
+  void check_diagonal(const int diagonal) const override {
+    if (diagonal < 0 || diagonal > 3) {
+      throw std::runtime_error("Error in switching the diagonal covariance.");
+    }
+  }
+
+private :
+
+  template <typename FeatureT>
+  bool dispatch(const FeatureT& feature, const int label) {
+    return nherd::dispatch(this->kDiagonal, [&](auto policy) {
+        return nherd::update<decltype(policy)>(feature, label, this->_means, this->_covariances, this->kC);
+      });
+  }
+
+public :
+
+  std::string name() const override {
+    return std::string("NHERD");
+  }
+
+  bool update(const Eigen::VectorXd& feature, const int label) override {
+    return dispatch(feature, label);
+  }
+
+  bool update(const Eigen::SparseVector<double>& feature, const int label) override {
+    return dispatch(feature, label);
+  }
+};
+
+using NHERD = DynamicNHERD<double>;
+using NHERDf = DynamicNHERD<float>;
+
 #endif //MOCHIMOCHI_NHERD_HPP_
@@ -2,106 +2,157 @@
 #define MOCHIMOCHI_PA_HPP_
 
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/nvp.hpp>
 #include <boost/serialization/split_member.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
+#include <algorithm>
 #include <fstream>
-#include <functional>
+#include <stdexcept>
+#include "../../functions/dot.hpp"
 #include "../../functions/enumerate.hpp"
 #include "../factory/binary_oml.hpp"
 
-class PA : public BinaryOML {
-private :
+// The PA variants, as policies of BasicPA. tau is the step size of one coordinate given
+// its value and the hinge loss of the example. A zero value moves the weight by
+// tau * value = 0 whatever tau is, so instead of branching around the divide by zero the
+// denominator is bumped to 1 for it: the update loop then has no control flow and vectorizes.
+namespace pa {
+  struct Plain {
+    static constexpr int kSelect = 0;
+
+    static double tau(const double value, const double loss, const double) {
+      return loss / (value * value + (value == 0));
+    }
+  };
+
+  struct I {
+    static constexpr int kSelect = 1;
+
+    static double tau(const double value, const double loss, const double C) {
+      return std::min(C, loss / (value * value + (value == 0)));
+    }
+  };
+
+  struct II {
+    static constexpr int kSelect = 2;
+
+    static double tau(const double value, const double loss, const double C) {
+      return loss / (value * value + 1.0 / 2 * C);
+    }
+  };
+
+  // The PA update with the variant VariantT on a weight vector of any scalar type, which may
+  // also be a row of a multi-class model (ClassMatrix::Row).
+  template <typename VariantT, typename VectorT>
+  void update_weight(const Eigen::VectorXd& feature, const int label, VectorT& weight, const double C, const double loss) {
+    const auto x = feature.data();
+    const auto w = weight.data();
+    const auto n = feature.size();
+    for (auto i = decltype(n)(0); i < n; ++i) {
+      w[i] += VariantT::tau(x[i], loss, C) * label * x[i];
+    }
+  }
+
+  template <typename VariantT, typename VectorT>
+  void update_weight(const Eigen::SparseVector<double>& feature, const int label, VectorT& weight, const double C, const double loss) {
+    functions::enumerate(feature,
+                         [&](const std::size_t index, const double value) {
+                           weight[index] += VariantT::tau(value, loss, C) * label * value;
+                         });
+  }
+
+  // Returns whether the example had a loss, i.e. whether the weight moved.
+  template <typename VariantT, typename FeatureT, typename VectorT>
+  bool update(const FeatureT& feature, const int label, VectorT& weight, const double C) {
+    const auto loss = std::max(0.0, 1.0 - label * functions::dot(feature, weight));
+    /* tau * value is zero for every variant without a loss. */
+    if (loss > 0.0) { update_weight<VariantT>(feature, label, weight, C, loss); }
+    return loss > 0.0;
+  }
+
+  // Calls f(VariantT()) with the variant of the run-time select.
+  template <typename FunctionT>
+  auto dispatch(const int select, FunctionT f) {
+    switch(select) {
+    case 0 :
+      return f(Plain());
+    case 1 :
+      return f(I());
+    default :
+      return f(II());
+    }
+  }
+};
+
+/**
+ * Weights, prediction and serialization shared by BasicPA and DynamicPA, with the weights
+ * stored as ScalarT. The file format does not depend on the class, so a model saved by one
+ * loads into the other.
+ */
+template <typename ScalarT>
+class PABase : public BinaryOML {
+public :
+  using Vector = Eigen::Matrix<ScalarT, Eigen::Dynamic, 1>;
+
+protected :
   const std::size_t kDim;
   const double kC;
   const int kSelect;
 
-private :
-  Eigen::VectorXd _weight;
-  std::function<double(double, double)> _compute_tau;
+protected :
+  Vector _weight;
 
-public :
-  PA(const std::size_t dim, const double C, const int select = 2)
+protected :
+  PABase(const std::size_t dim, const double C, const int select)
     : kDim(dim),
       kC(C),
       kSelect(select),
-      _weight(Eigen::VectorXd::Zero(dim)) {
+      _weight(Vector::Zero(dim)) {
 
     static_assert(std::numeric_limits<decltype(dim)>::max() > 0, "Dimension Error. (Dimension > 0)");
     static_assert(std::numeric_limits<decltype(C)>::max() > 0, "Hyper Parameter Error. (C > 0)");
-
-    // int select : switching the PA algorithm
-    // 0 : PA
-    // 1 : PA-I
-    // 2 : PA-II
-    switch(kSelect) {
-    case 0 :
-      _compute_tau = [=](const auto value, const auto loss) {
-        /* Check for divide by zero in which case return zero for tau. */
-        /* If "value" is non-zero then proceed with division and return result. */
-        return (value == 0) ? 0 : loss / std::pow(std::abs(value), 2);
-      };
-      break;
-    case 1 :
-      _compute_tau = [=](const auto value, const auto loss) {
-        /* Possible divide by zero situation if "value" is zero resulting in pa = inf. */
-        /* Check for this with a ternary operator and return kC if value == 0. */
-        /* Using the ternary check instead of just relying on std::min in case it's possible to get a -inf (not sure). */
-        const auto pa = loss / std::pow(std::abs(value), 2);
-        return (value == 0) ? kC : std::min(kC, pa);
-      };
-      break;
-    case 2 :
-      _compute_tau = [=](const auto value, const auto loss) {
-        return loss / (std::pow(std::abs(value), 2) + 1.0 / 2 * kC);
-      };
-      break;
-    default:
-      std::runtime_error("Error in the PA algorithm.");
-    }
-
   }
 
-  virtual ~PA() { }
+public :
+  virtual ~PABase() { }
 
-private :
+protected :
 
-  double suffer_loss(const Eigen::VectorXd& x, const int y) const {
-    return std::max(0.0, 1.0 - y * _weight.dot(x));
+  template <typename FeatureT>
+  double compute_margin(const FeatureT& x) const {
+    return functions::dot(x, _weight);
   }
 
-  double compute_margin(const Eigen::VectorXd& x) const {
-    return _weight.dot(x);
+  Eigen::VectorXd batch_margins(const Eigen::MatrixXd& X) const override {
+    return functions::dot_rows(X, _weight);
   }
 
-public :
-
-  std::string name() const override {
-    return std::string("PA");
+  Eigen::VectorXd batch_margins(const CsrMatrix& X) const override {
+    return functions::dot_rows(X, _weight);
   }
 
-  bool update(const Eigen::VectorXd& feature, const int label) override {
-    const auto loss = suffer_loss(feature, label);
-    functions::enumerate(feature.data(), feature.data() + feature.size(), 0,
-                         [&](const std::size_t index, const double value) {
-                           const auto tau = _compute_tau(value, loss);
-                           _weight[index] += tau * label * value;
-                         });
+public :
 
-    return true;
+  int predict(const Eigen::VectorXd& x) const override {
+    return compute_margin(x) > 0.0 ? 1 : -1;
   }
 
-  int predict(const Eigen::VectorXd& x) const override {
+  int predict(const Eigen::SparseVector<double>& x) const override {
     return compute_margin(x) > 0.0 ? 1 : -1;
   }
 
-  Eigen::VectorXd get_weight(void) const {
+  Vector get_weight(void) const {
     return _weight;
   }
 
+  Eigen::VectorXd inference_weights(void) const override {
+    return _weight.template cast<double>();
+  }
+
   void save(const std::string& filename) override {
     std::ofstream ofs(filename);
     assert(ofs);
@@ -123,7 +174,7 @@ private :
   BOOST_SERIALIZATION_SPLIT_MEMBER();
   template <class Archive>
   void save(Archive& ar, const unsigned int version) const {
-    std::vector<double> weight(_weight.data(), _weight.data() + _weight.size());
+    std::vector<ScalarT> weight(_weight.data(), _weight.data() + _weight.size());
     ar & boost::serialization::make_nvp("weight", weight);
     ar & boost::serialization::make_nvp("dimension", const_cast<std::size_t&>(kDim));
     ar & boost::serialization::make_nvp("C", const_cast<double&>(kC));
@@ -132,13 +183,121 @@ private :
 
   template <class Archive>
   void load(Archive& ar, const unsigned int version) {
-    std::vector<double> weight;
+    std::vector<ScalarT> weight;
+    std::size_t dim;
+    double C;
+    int select;
     ar & boost::serialization::make_nvp("weight", weight);
-    ar & boost::serialization::make_nvp("dimension", const_cast<std::size_t&>(kDim));
-    ar & boost::serialization::make_nvp("C", const_cast<double&>(kC));
-    ar & boost::serialization::make_nvp("select", const_cast<int&>(kSelect));
-    _weight = Eigen::Map<Eigen::VectorXd>(&weight[0], weight.size());
+    ar & boost::serialization::make_nvp("dimension", dim);
+    ar & boost::serialization::make_nvp("C", C);
+    ar & boost::serialization::make_nvp("select", select);
+    check_select(select);
+
+    const_cast<std::size_t&>(kDim) = dim;
+    const_cast<double&>(kC) = C;
+    const_cast<int&>(kSelect) = select;
+    _weight = Eigen::Map<Vector>(&weight[0], weight.size());
+  }
+
+protected :
+  // Throws when a loaded model file has a variant this class cannot train; the model is left
+  // as it was.
+  virtual void check_select(const int select) const = 0;
+};
+
+/**
+ * PA with the variant chosen at compile time, so the step size is inlined into the update
+ * loop:
+ *
+ *   BasicPA<pa::I> pa(dim, C);
+ *   BasicPA<pa::I, float> pa32(dim, C);
+ */
+template <typename VariantT, typename ScalarT = double>
+class BasicPA : public PABase<ScalarT> {
+public :
+  BasicPA(const std::size_t dim, const double C)
+    : PABase<ScalarT>(dim, C, VariantT::kSelect) { }
+
+  virtual ~BasicPA() { }
+
+protected :
+  void check_select(const int select) const override {
+    if (select != VariantT::kSelect) {
+      throw std::runtime_error("The PA variant of the model file does not match BasicPA.");
+    }
+  }
+
+public :
+
+  std::string name() const override {
+    return std::string("PA");
+  }
+
+  bool update(const Eigen::VectorXd& feature, const int label) override {
+    pa::update<VariantT>(feature, label, this->_weight, this->kC);
+    return true;
+  }
+
+  bool update(const Eigen::SparseVector<double>& feature, const int label) override {
+    pa::update<VariantT>(feature, label, this->_weight, this->kC);
+    return true;
   }
 };
 
+/**
+ * PA with the variant chosen at run time (PA or PAf). The variant is dispatched once per
+ * update to the same kernels as BasicPA.
+ */
+template <typename ScalarT>
+class DynamicPA : public PABase<ScalarT> {
+public :
+  DynamicPA(const std::size_t dim, const double C, const int select = 2)
+    : PABase<ScalarT>(dim, C, select) {
+
+    // int select : switching the PA algorithm
+    // 0 : PA
+    // 1 : PA-I
+    // 2 : PA-II
+    if (select < 0 || select > 2) {
+      throw std::runtime_error("Error in the PA algorithm.");
+    }
+  }
+
+  virtual ~DynamicPA() { }
+
+protected :
+  void check_select(const int select) const override {
+    if (select < 0 || select > 2) {
+      throw std::runtime_error("Error in the PA algorithm.");
+    }
+  }
+
+private :
+
+  template <typename FeatureT>
+  bool dispatch(const FeatureT& feature, const int label) {
+    pa::dispatch(this->kSelect, [&](auto variant) {
+        return pa::update<decltype(variant)>(feature, label, this->_weight, this->kC);
+      });
+    return true;
+  }
+
+public :
+
+  std::string name() const override {
+    return std::string("PA");
+  }
+
+  bool update(const Eigen::VectorXd& feature, const int label) override {
+    return dispatch(feature, label);
+  }
+
+  bool update(const Eigen::SparseVector<double>& feature, const int label) override {
+    return dispatch(feature, label);
+  }
+};
+
+using PA = DynamicPA<double>;
+using PAf = DynamicPA<float>;
+
 #endif //MOCHIMOCHI_PA_HPP_
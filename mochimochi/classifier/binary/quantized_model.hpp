@@ -0,0 +1,311 @@
+#ifndef MOCHIMOCHI_QUANTIZED_MODEL_HPP_
+#define MOCHIMOCHI_QUANTIZED_MODEL_HPP_
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../../functions/quantized.hpp"
+#include "../factory/binary_oml.hpp"
+
+enum class QuantizedType : std::uint32_t {
+  Int8 = 1,
+  Float16 = 2
+};
+
+/**
+ * Layout of a quantized model file. Every section starts on an 8 byte boundary.
+ *
+ *   QuantizedHeader
+ *   float                     scales[blocks]
+ *   std::int8_t/std::uint16_t weights[blocks * block]   (zero padded)
+ */
+struct QuantizedHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t type;
+  std::uint64_t dim;
+  std::uint64_t block;
+};
+
+/**
+ * Inference-only export of a trained BinaryOML: only the weights used by predict() are
+ * kept, as int8 or fp16 values with one float scale per block of `block` coordinates. A
+ * model takes 1 (int8) or 2 (fp16) bytes per dimension instead of the 16 to 32 bytes of the
+ * trainable model with its covariances or moments.
+ *
+ *   QuantizedModel int8(arow, QuantizedType::Int8);
+ *   int8.save("arow.q8");
+ *   QuantizedModel served("arow.q8");
+ *   served.predict(x);
+ *
+ * A dense feature is multiplied block by block by the int8 or fp16 weights, widened in
+ * registers (AVX2/F16C when available), and each block sum by its scale. A sparse feature is
+ * multiplied by the dequantized weights of its stored coordinates.
+ *
+ * The export saves memory; it is not faster for a model that already fits in cache. On
+ * example2 (AROW, dim 8000, 64KB of double weights) a sparse predict costs more with either
+ * export than with the full model, since each stored coordinate also loads its block scale
+ * and converts the weight. Predict latency only improves once the double weights no longer
+ * fit in the cache and the 8x (int8) or 4x (fp16) smaller weights do.
+ */
+class QuantizedModel {
+private :
+  static constexpr char kMagic[8] = {'M', 'O', 'C', 'H', 'I', 'Q', 'N', 'T'};
+  static constexpr std::uint32_t kVersion = 1;
+  static constexpr std::size_t kMaxBlock = 4096;
+
+private :
+  QuantizedType _type;
+  std::size_t _dim;
+  std::size_t _block;
+  std::size_t _shift;
+  std::vector<float> _scales;
+  std::vector<std::int8_t> _int8;
+  std::vector<std::uint16_t> _half;
+
+public :
+  QuantizedModel(const Eigen::VectorXd& weights, const QuantizedType type, const std::size_t block = 128)
+    : _type(type),
+      _dim(weights.size()) {
+    set_block(block);
+    quantize(weights);
+  }
+
+  QuantizedModel(const BinaryOML& model, const QuantizedType type, const std::size_t block = 128)
+    : QuantizedModel(model.inference_weights(), type, block) { }
+
+  explicit QuantizedModel(const std::string& filename) {
+    load(filename);
+  }
+
+  virtual ~QuantizedModel() { }
+
+private :
+
+  static std::size_t align8(const std::size_t offset) {
+    return (offset + 7) & ~std::size_t(7);
+  }
+
+  // The block is a power of two so a sparse coordinate finds its scale with a shift.
+  void set_block(const std::size_t block) {
+    if (block < 32 || block > kMaxBlock || (block & (block - 1)) != 0) {
+      throw std::runtime_error("The block of a quantized model is a power of two in [32, 4096].");
+    }
+    _block = block;
+    _shift = 0;
+    while ((std::size_t(1) << _shift) < block) { ++_shift; }
+  }
+
+  std::size_t blocks() const {
+    return (_dim + _block - 1) / _block;
+  }
+
+  std::size_t value_size() const {
+    return _type == QuantizedType::Int8 ? sizeof(std::int8_t) : sizeof(std::uint16_t);
+  }
+
+  void quantize(const Eigen::VectorXd& weights) {
+    _scales.assign(blocks(), 0.0f);
+    _int8.clear();
+    _half.clear();
+    if (_type == QuantizedType::Int8) {
+      _int8.assign(blocks() * _block, 0);
+    } else if (_type == QuantizedType::Float16) {
+      _half.assign(blocks() * _block, 0);
+    } else {
+      throw std::runtime_error("Unknown quantized type.");
+    }
+
+    for (std::size_t b = 0; b < blocks(); ++b) {
+      const auto first = b * _block;
+      const auto size = std::min(_block, _dim - first);
+      const auto max = functions::max_abs(weights.data() + first, size);
+      if (!(max > 0.0) || !std::isfinite(max)) { continue; }
+
+      if (_type == QuantizedType::Int8) {
+        // symmetric [-127, 127], which the int8 dot product relies on
+        _scales[b] = static_cast<float>(max / 127.0);
+        const auto inverse = 127.0 / max;
+        for (std::size_t i = 0; i < size; ++i) {
+          _int8[first + i] = static_cast<std::int8_t>(std::lround(weights[first + i] * inverse));
+        }
+      } else {
+        // scaled into [-1, 1], where fp16 keeps 11 significant bits
+        _scales[b] = static_cast<float>(max);
+        for (std::size_t i = 0; i < size; ++i) {
+          _half[first + i] = functions::float_to_half(static_cast<float>(weights[first + i] / max));
+        }
+      }
+    }
+  }
+
+  double margin_int8(const Eigen::VectorXd& x) const {
+    auto margin = 0.0;
+    for (std::size_t b = 0; b < blocks(); ++b) {
+      const auto first = b * _block;
+      const auto size = std::min(_block, _dim - first);
+      margin += _scales[b] * functions::dot_int8(_int8.data() + first, x.data() + first, size);
+    }
+    return margin;
+  }
+
+  double margin_half(const Eigen::VectorXd& x) const {
+    auto margin = 0.0;
+    for (std::size_t b = 0; b < blocks(); ++b) {
+      const auto first = b * _block;
+      const auto size = std::min(_block, _dim - first);
+      margin += _scales[b] * functions::dot_half(_half.data() + first, x.data() + first, size);
+    }
+    return margin;
+  }
+
+public :
+
+  /**
+   * x・w with the quantized weights.
+   */
+  double margin(const Eigen::VectorXd& x) const {
+    // The kernels read _dim coordinates of x.
+    if (static_cast<std::size_t>(x.size()) != _dim) {
+      throw std::runtime_error("The feature does not have the dimension of the quantized model.");
+    }
+    return _type == QuantizedType::Int8 ? margin_int8(x) : margin_half(x);
+  }
+
+  double margin(const Eigen::SparseVector<double>& x) const {
+    const auto indices = x.innerIndexPtr();
+    const auto values = x.valuePtr();
+    const auto nnz = x.nonZeros();
+    // The stored indices are sorted, so the last one bounds them all.
+    if (nnz > 0 && static_cast<std::size_t>(indices[nnz - 1]) >= _dim) {
+      throw std::runtime_error("The feature has more dimensions than the quantized model.");
+    }
+    auto margin = 0.0;
+    if (_type == QuantizedType::Int8) {
+      for (auto i = decltype(nnz)(0); i < nnz; ++i) {
+        const auto index = indices[i];
+        margin += values[i] * _scales[index >> _shift] * _int8[index];
+      }
+    } else {
+      for (auto i = decltype(nnz)(0); i < nnz; ++i) {
+        const auto index = indices[i];
+        margin += values[i] * _scales[index >> _shift] * functions::half_to_float(_half[index]);
+      }
+    }
+    return margin;
+  }
+
+  int predict(const Eigen::VectorXd& x) const {
+    return margin(x) > 0.0 ? 1 : -1;
+  }
+
+  int predict(const Eigen::SparseVector<double>& x) const {
+    return margin(x) > 0.0 ? 1 : -1;
+  }
+
+  /**
+   * The weights as they are used by margin(), e.g. to measure the quantization error.
+   */
+  Eigen::VectorXd dequantize(void) const {
+    Eigen::VectorXd weights(_dim);
+    for (std::size_t i = 0; i < _dim; ++i) {
+      const auto value = _type == QuantizedType::Int8 ? static_cast<float>(_int8[i]) : functions::half_to_float(_half[i]);
+      weights[i] = static_cast<double>(_scales[i >> _shift]) * value;
+    }
+    return weights;
+  }
+
+  QuantizedType type() const { return _type; }
+  std::size_t dim() const { return _dim; }
+  std::size_t block() const { return _block; }
+
+  /**
+   * Memory taken by the scales and the weights.
+   */
+  std::size_t bytes() const {
+    return _scales.size() * sizeof(float) + blocks() * _block * value_size();
+  }
+
+  void save(const std::string& filename) const {
+    QuantizedHeader header;
+    std::copy(kMagic, kMagic + 8, header.magic);
+    header.version = kVersion;
+    header.type = static_cast<std::uint32_t>(_type);
+    header.dim = _dim;
+    header.block = _block;
+
+    std::ofstream ofs(filename, std::ios::binary);
+    if (!ofs) { throw std::runtime_error("Cannot create file: " + filename); }
+    const char padding[8] = {};
+    const auto scales_offset = align8(sizeof(header));
+    const auto weights_offset = align8(scales_offset + _scales.size() * sizeof(float));
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ofs.write(padding, scales_offset - sizeof(header));
+    ofs.write(reinterpret_cast<const char*>(_scales.data()), _scales.size() * sizeof(float));
+    ofs.write(padding, weights_offset - scales_offset - _scales.size() * sizeof(float));
+    if (_type == QuantizedType::Int8) {
+      ofs.write(reinterpret_cast<const char*>(_int8.data()), _int8.size());
+    } else {
+      ofs.write(reinterpret_cast<const char*>(_half.data()), _half.size() * sizeof(std::uint16_t));
+    }
+    if (!ofs) { throw std::runtime_error("Cannot write file: " + filename); }
+  }
+
+  void load(const std::string& filename) {
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs) { throw std::runtime_error("Cannot open file: " + filename); }
+
+    QuantizedHeader header;
+    if (!ifs.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        !std::equal(kMagic, kMagic + 8, header.magic)) {
+      throw std::runtime_error("Not a quantized model file: " + filename);
+    }
+    if (header.version != kVersion) { throw std::runtime_error("Unsupported quantized model version: " + filename); }
+    if (header.type != static_cast<std::uint32_t>(QuantizedType::Int8) &&
+        header.type != static_cast<std::uint32_t>(QuantizedType::Float16)) {
+      throw std::runtime_error("Unknown quantized type: " + filename);
+    }
+
+    // The header is checked against the file size before anything is allocated from it.
+    ifs.seekg(0, std::ios::end);
+    const auto file_size = static_cast<std::uint64_t>(ifs.tellg());
+    const auto header_value_size = header.type == static_cast<std::uint32_t>(QuantizedType::Int8) ? sizeof(std::int8_t) : sizeof(std::uint16_t);
+    if (header.dim == 0 || header.dim > file_size || header.block == 0 || header.block > kMaxBlock) {
+      throw std::runtime_error("Corrupt quantized model header: " + filename);
+    }
+    const auto header_blocks = (header.dim + header.block - 1) / header.block;
+    const auto expected_size = align8(align8(sizeof(header)) + header_blocks * sizeof(float)) + header_blocks * header.block * header_value_size;
+    if (file_size < expected_size) { throw std::runtime_error("Truncated quantized model file: " + filename); }
+
+    _type = static_cast<QuantizedType>(header.type);
+    _dim = header.dim;
+    set_block(header.block);
+    _scales.assign(blocks(), 0.0f);
+    _int8.clear();
+    _half.clear();
+
+    const auto scales_offset = align8(sizeof(header));
+    const auto weights_offset = align8(scales_offset + _scales.size() * sizeof(float));
+    ifs.seekg(scales_offset);
+    ifs.read(reinterpret_cast<char*>(_scales.data()), _scales.size() * sizeof(float));
+    ifs.seekg(weights_offset);
+    if (_type == QuantizedType::Int8) {
+      _int8.assign(blocks() * _block, 0);
+      ifs.read(reinterpret_cast<char*>(_int8.data()), _int8.size());
+    } else {
+      _half.assign(blocks() * _block, 0);
+      ifs.read(reinterpret_cast<char*>(_half.data()), _half.size() * sizeof(std::uint16_t));
+    }
+    if (!ifs) { throw std::runtime_error("Truncated quantized model file: " + filename); }
+  }
+};
+
+constexpr char QuantizedModel::kMagic[8];
+
+#endif //MOCHIMOCHI_QUANTIZED_MODEL_HPP_
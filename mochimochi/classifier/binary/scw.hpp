@@ -2,6 +2,7 @@
 #define MOCHIMOCHI_SCW_HPP_
 
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 #include <boost/math/special_functions/erf.hpp>
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/nvp.hpp>
@@ -10,31 +11,81 @@
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 #include <fstream>
-#include "../../functions/enumerate.hpp"
+#include "../../functions/dot.hpp"
+#include "../../functions/fused.hpp"
 #include "../factory/binary_oml.hpp"
 
-class SCW : public BinaryOML {
+// The SCW update on a mean and covariance vector of any scalar type, which may also be the
+// rows of a multi-class model (ClassMatrix::Row). phi is cdf(eta).
+namespace scw {
+  inline double cdf(const double x) {
+    return 0.5 * (1.0 + boost::math::erf(x / std::sqrt(2.0)));
+  }
+
+  // m : label * margin, v : confidence
+  inline double suffer_loss(const double m, const double v, const double phi) {
+    return std::max(0.0, phi * std::sqrt(v) - m);
+  }
+
+  //Proposition 1
+  inline double compute_alpha(const double m, const double n, const double v, const double ganma, const double C, const double phi) {
+    const auto psi = 1.0 + phi * phi / 2.0;
+    const auto zeta = 1.0 + phi * phi;
+    const auto tmp1 = -m * psi + std::sqrt(m * m * std::pow(phi, 4.0) / 4.0 + v * phi * phi * zeta);
+    const auto tmp2 = 1.0 / v * zeta * tmp1;
+    return std::min(C, std::max(0.0, tmp2));
+  }
+
+  inline double compute_beta(const double alpha, const double v, const double phi) {
+    const auto u = std::pow(-alpha * v * phi + std::sqrt(alpha * alpha * v * v * phi * phi + 4.0 * v), 2.0) / 4.0;
+    return alpha * phi / (std::sqrt(u) + v * alpha * phi);
+  }
+
+  template <typename FeatureT, typename VectorT>
+  bool update(const FeatureT& feature, const int label, VectorT& means, VectorT& covariances, const double C, const double phi) {
+    // v and m are read in one pass and reused by the loss, so a non-violating example costs
+    // a single pass and alpha/beta are only computed for an actual update.
+    const auto margin_confidence = functions::margin_and_confidence(feature, means, covariances);
+    const auto v = margin_confidence.second;
+    const auto m = label * margin_confidence.first;
+
+    if (suffer_loss(m, v, phi) <= 0.0) { return false; }
+
+    const auto n = v + 1.0 / 2.0 * C;
+    const auto ganma = phi * std::sqrt(phi * phi * m * m * v * v + 4.0 * n * v * (n + v * phi * phi));
+    const auto alpha = compute_alpha(m, n, v, ganma, C, phi);
+    const auto beta = compute_beta(alpha, ganma, phi);
+
+    functions::update_means_and_covariances(feature, means, covariances, alpha * label, beta);
+
+    return true;
+  }
+};
+
+/**
+ * SCW with its means and covariances stored as ScalarT (SCW or SCWf).
+ */
+template <typename ScalarT>
+class BasicSCW : public BinaryOML {
+public :
+  using Vector = Eigen::Matrix<ScalarT, Eigen::Dynamic, 1>;
+
 private :
   const std::size_t kDim;
   const double kC;
   const double kPhi;
 
 private :
-  Eigen::VectorXd _covariances;
-  Eigen::VectorXd _means;
-
-private :
-  inline double cdf(const double x) const {
-    return 0.5 * (1.0 + boost::math::erf(x / std::sqrt(2.0)));
-  }
+  Vector _covariances;
+  Vector _means;
 
 public :
-  SCW(const std::size_t dim, const double c, const double eta)
+  BasicSCW(const std::size_t dim, const double c, const double eta)
     : kDim(dim),
       kC(c),
-      kPhi(cdf(eta)),
-      _covariances(Eigen::VectorXd::Ones(kDim)),
-      _means(Eigen::VectorXd::Zero(kDim)) {
+      kPhi(scw::cdf(eta)),
+      _covariances(Vector::Ones(kDim)),
+      _means(Vector::Zero(kDim)) {
 
     static_assert(std::numeric_limits<decltype(dim)>::max() > 0, "Dimension Error. (Dimension > 0)");
     static_assert(std::numeric_limits<decltype(c)>::max() > 0, "Hyper Parameter Error. (c > 0)");
@@ -44,36 +95,21 @@ public :
     assert(eta > 0);
   }
 
-  virtual ~SCW() { }
+  virtual ~BasicSCW() { }
 
 private :
 
-  double suffer_loss(const Eigen::VectorXd& f, const int label) const {
-    const auto confidence = compute_confidence(f);
-    return std::max(0.0, kPhi * std::sqrt(confidence) - label * _means.dot(f));
-  }
-
-  //Proposition 1
-  double compute_alpha(const double m, const double n, const double v, const double ganma) const {
-    const auto psi = 1.0 + kPhi * kPhi / 2.0;
-    const auto zeta = 1.0 + kPhi * kPhi;
-    const auto tmp1 = -m * psi + std::sqrt(m * m * std::pow(kPhi, 4.0) / 4.0 + v * kPhi * kPhi * zeta);
-    const auto tmp2 = 1.0 / v * zeta * tmp1;
-    return std::min(kC, std::max(0.0, tmp2));
+  Eigen::VectorXd batch_margins(const Eigen::MatrixXd& X) const override {
+    return functions::dot_rows(X, _means);
   }
 
-  double compute_beta(const double alpha, const double v) const {
-    const auto u = std::pow(-alpha * v * kPhi + std::sqrt(alpha * alpha * v * v * kPhi * kPhi + 4.0 * v), 2.0) / 4.0;
-    return alpha * kPhi / (std::sqrt(u) + v * alpha * kPhi);
+  Eigen::VectorXd batch_margins(const CsrMatrix& X) const override {
+    return functions::dot_rows(X, _means);
   }
 
-  double compute_confidence(const Eigen::VectorXd& f) const {
-    auto confidence = 0.0;
-    functions::enumerate(f.data(), f.data() + f.size(), 0,
-                       [&](const int index, const double value) {
-                         confidence += _covariances[index] * value * value;
-                       });
-    return confidence;
+  // predict() labels a zero margin as +1
+  Eigen::VectorXi batch_labels(const Eigen::VectorXd& margins) const override {
+    return ((margins.array() >= 0.0).cast<int>() * 2 - 1).matrix();
   }
 
 public :
@@ -83,33 +119,29 @@ public :
   }
 
   bool update(const Eigen::VectorXd& feature, const int label) override {
-    const auto v = compute_confidence(feature);
-    const auto m = label * _means.dot(feature);
-    const auto n = v + 1.0 / 2.0 * kC;
-    const auto ganma = kPhi * std::sqrt(kPhi * kPhi * m * m * v * v + 4.0 * n * v * (n + v * kPhi * kPhi));
-    const auto alpha = compute_alpha(m, n, v, ganma);
-    const auto beta = compute_beta(alpha, ganma);
-
-    if (suffer_loss(feature, label) <= 0.0) { return false; }
-
-    functions::enumerate(feature.data(), feature.data() + feature.size(), 0,
-                       [&](const int index, const double value) {
-                         const auto v = _covariances[index] * value;
-                         _means[index] += alpha * label * v;
-                         _covariances[index] -= beta * v * v;
-                       });
+    return scw::update(feature, label, _means, _covariances, kC, kPhi);
+  }
 
-    return true;
+  bool update(const Eigen::SparseVector<double>& feature, const int label) override {
+    return scw::update(feature, label, _means, _covariances, kC, kPhi);
   }
 
   int predict(const Eigen::VectorXd& x) const override {
-    return _means.dot(x) < 0.0 ? -1 : 1;
+    return functions::dot(x, _means) < 0.0 ? -1 : 1;
   }
 
-  Eigen::VectorXd get_means(void) const {
+  int predict(const Eigen::SparseVector<double>& x) const override {
+    return functions::dot(x, _means) < 0.0 ? -1 : 1;
+  }
+
+  Vector get_means(void) const {
     return _means;
   }
 
+  Eigen::VectorXd inference_weights(void) const override {
+    return _means.template cast<double>();
+  }
+
   void save(const std::string& filename) override {
     std::ofstream ofs(filename);
     assert(ofs);
@@ -131,8 +163,8 @@ private :
   BOOST_SERIALIZATION_SPLIT_MEMBER();
   template <class Archive>
   void save(Archive& ar, const unsigned int version) const {
-    std::vector<double> covariances_vector(_covariances.data(), _covariances.data() + _covariances.size());
-    std::vector<double> means_vector(_means.data(), _means.data() + _means.size());
+    std::vector<ScalarT> covariances_vector(_covariances.data(), _covariances.data() + _covariances.size());
+    std::vector<ScalarT> means_vector(_means.data(), _means.data() + _means.size());
     ar & boost::serialization::make_nvp("covariances", covariances_vector);
     ar & boost::serialization::make_nvp("means", means_vector);
     ar & boost::serialization::make_nvp("dimension", const_cast<std::size_t&>(kDim));
@@ -142,17 +174,20 @@ private :
 
   template <class Archive>
   void load(Archive& ar, const unsigned int version) {
-    std::vector<double> covariances_vector;
-    std::vector<double> means_vector;
+    std::vector<ScalarT> covariances_vector;
+    std::vector<ScalarT> means_vector;
     ar & boost::serialization::make_nvp("covariances", covariances_vector);
     ar & boost::serialization::make_nvp("means", means_vector);
     ar & boost::serialization::make_nvp("dimension", const_cast<std::size_t&>(kDim));
     ar & boost::serialization::make_nvp("phi", const_cast<double&>(kPhi));
     ar & boost::serialization::make_nvp("c", const_cast<double&>(kC));
-    _covariances = Eigen::Map<Eigen::VectorXd>(&covariances_vector[0], covariances_vector.size());
-    _means = Eigen::Map<Eigen::VectorXd>(&means_vector[0], means_vector.size());
+    _covariances = Eigen::Map<Vector>(&covariances_vector[0], covariances_vector.size());
+    _means = Eigen::Map<Vector>(&means_vector[0], means_vector.size());
   }
 
 };
 
+using SCW = BasicSCW<double>;
+using SCWf = BasicSCW<float>;
+
 #endif //MOCHIMOCHI_SCW_HPP_
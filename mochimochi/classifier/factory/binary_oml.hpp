@@ -2,21 +2,116 @@
 #define MOCHIMOCHI_BINARY_OML_INTERFACE_HPP_
 
 #include <string>
+#include <cstdint>
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "../../functions/dot.hpp"
 
 using namespace std;
 
+namespace utility {
+  template<typename T, typename ValueT> class CsrDataset;
+}
+
 /**
  * The BinaryOML interface declares the operations that all concrete BinaryOML must implement.
+ *
+ * The sparse overloads of update/predict only visit the stored coordinates of the feature,
+ * so their cost is O(nnz) instead of O(dim).
+ *
+ * inference_weights() is the weight vector w for which predict(x) is the sign of x・w; it
+ * is what an inference-only export (QuantizedModel) keeps of the model.
+ *
+ * The batch overloads score one example per row of a dense matrix, a CSR matrix or a CSR
+ * cache with a single GEMV/SpMV, instead of one virtual predict() call per row:
+ *
+ *   const Eigen::VectorXi labels = arow.predict_batch(X);
+ *
+ * The classifiers multiply the matrices by their own weights (batch_margins()). A CSR cache
+ * is multiplied by inference_weights(), whose O(dim) copy is paid once for the whole file.
+ * A batch whose number of columns differs from the model dimension throws.
  */
 class BinaryOML {
  public:
+  using CsrMatrix = Eigen::SparseMatrix<double, Eigen::RowMajor>;
+
   virtual ~BinaryOML() {}
   virtual bool update(const Eigen::VectorXd& feature, const int label) = 0;
   virtual int predict(const Eigen::VectorXd& x) const = 0;
+  virtual bool update(const Eigen::SparseVector<double>& feature, const int label) = 0;
+  virtual int predict(const Eigen::SparseVector<double>& x) const = 0;
   virtual void save(const string& filename) = 0;
   virtual void load(const string& filename) = 0;
   virtual string name() const = 0;
+  virtual Eigen::VectorXd inference_weights() const = 0;
+
+  /**
+   * Apply the updates a mini-batch learner still holds (ADAM and ADAGRAD_RDA with
+   * batch_size > 1). The other learners update on every example and have nothing to flush.
+   */
+  virtual void flush() {}
+
+  /**
+   * x・w of every row x of X.
+   */
+  Eigen::VectorXd decision_function_batch(const Eigen::MatrixXd& X) const {
+    return batch_margins(X);
+  }
+
+  Eigen::VectorXd decision_function_batch(const CsrMatrix& X) const {
+    return batch_margins(X);
+  }
+
+  template<typename T, typename ValueT>
+  Eigen::VectorXd decision_function_batch(const utility::CsrDataset<T, ValueT>& dataset) const {
+    const auto weights = inference_weights();
+    functions::check_batch_dim(dataset.dim(), weights.size());
+    const auto w = weights.data();
+    const auto offsets = dataset.offsets();
+    const auto indices = dataset.indices();
+    const auto values = dataset.values();
+    const auto rows = dataset.rows();
+
+    Eigen::VectorXd margins(rows);
+    for (std::size_t row = 0; row < rows; ++row) {
+      auto margin = 0.0;
+      for (auto i = offsets[row]; i < offsets[row + 1]; ++i) {
+        margin += values[i] * w[indices[i]];
+      }
+      margins[row] = margin;
+    }
+    return margins;
+  }
+
+  /**
+   * The labels predict() gives to every row, as ±1.
+   */
+  Eigen::VectorXi predict_batch(const Eigen::MatrixXd& X) const {
+    return batch_labels(decision_function_batch(X));
+  }
+
+  Eigen::VectorXi predict_batch(const CsrMatrix& X) const {
+    return batch_labels(decision_function_batch(X));
+  }
+
+  template<typename T, typename ValueT>
+  Eigen::VectorXi predict_batch(const utility::CsrDataset<T, ValueT>& dataset) const {
+    return batch_labels(decision_function_batch(dataset));
+  }
+
+ protected:
+  virtual Eigen::VectorXd batch_margins(const Eigen::MatrixXd& X) const {
+    return functions::dot_rows(X, inference_weights());
+  }
+
+  virtual Eigen::VectorXd batch_margins(const CsrMatrix& X) const {
+    return functions::dot_rows(X, inference_weights());
+  }
+
+  // The labels predict() gives to these margins.
+  virtual Eigen::VectorXi batch_labels(const Eigen::VectorXd& margins) const {
+    return ((margins.array() > 0.0).cast<int>() * 2 - 1).matrix();
+  }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -22,6 +22,7 @@
 #include "../binary/scw.hpp"
 
 #include "../../utility/load_svmlight_file.hpp"
+#include "../../utility/parse_svmlight.hpp"
 
 using namespace std;
 
@@ -53,6 +54,16 @@ public:
    */
   virtual int infer(string *pInput, size_t dim) = 0;
 
+  /**
+   * Train/update the model with an already parsed sparse feature.
+   */
+  virtual void train(const Eigen::SparseVector<double>& feature, const int label) = 0;
+
+  /**
+   * Infer/predict the label of an already parsed sparse feature.
+   */
+  virtual int infer(const Eigen::SparseVector<double>& feature) = 0;
+
   /**
    * Load a saved/serialized model.
    */
@@ -74,6 +85,12 @@ public:
  * on BinaryOML objects, returned by the factory method. Subclasses can
  * indirectly change that business logic by overriding the factory method
  * and returning a different type of BinaryOML from it.
+ * 
+ * train(string*) and trainAndSave update the model on the dense feature, as they always
+ * have. trainSparse(string*) and train(SparseVector) update it on the sparse feature in
+ * O(nnz) instead; for ADAM this is the lazy sparse update (see BasicADAM::step), which
+ * trains a different model from the dense one. A blank or comment line is skipped by the
+ * train methods and predicted as the zero vector by infer.
 */
 class BinaryOMLCreator : public BinaryOMLInterface
 {
@@ -84,6 +101,13 @@ class BinaryOMLCreator : public BinaryOMLInterface
 protected:
   BinaryOML* m_pBinaryOML;
 
+  /**
+   * Scratch buffers reused by every train/infer call, so that steady-state calls do not
+   * allocate or zero a dim-sized vector.
+   */
+  Eigen::SparseVector<double> m_sparseFeature;
+  Eigen::VectorXd m_denseFeature;
+
   /* The constructor. */
   BinaryOMLCreator(BinaryOML* pBinaryOML)
   {
@@ -115,23 +139,39 @@ public:
    */
   void train(string *pInput, int dim)
   {
-    /* Convert training string input into training vector. */
-    auto data = utility::read_ones<int>(*pInput, dim);
+    /* Convert training string input into the scratch training vector. */
+    int label;
+    if (!parse(pInput, dim, label)) { return; }
 
     /* Update the model with the new training data. */
-    m_pBinaryOML->update(data.second, data.first);
+    updateDense(dim, label);
   }
 
   /**
-   * Train and save/serialize the model.
+   * Train the model on the sparse feature of the given input, in O(nnz).
    */
-  void trainAndSave(string *pInput, size_t dim, const string modelFilePath)
+  void trainSparse(string *pInput, size_t dim)
   {
-    /* Convert training string input into data vector. */
-    auto data = utility::read_ones<int>(*pInput, dim);
+    /* Convert training string input into the scratch training vector. */
+    int label;
+    if (!parse(pInput, dim, label)) { return; }
 
     /* Update the model with the new training data. */
-    m_pBinaryOML->update(data.second, data.first);
+    m_pBinaryOML->update(m_sparseFeature, label);
+  }
+
+  /**
+   * Train and save/serialize the model.
+   */
+  void trainAndSave(string *pInput, size_t dim, const string modelFilePath)
+  {
+    /* Convert training string input into the scratch data vector. */
+    int label;
+    if (parse(pInput, dim, label))
+    {
+      /* Update the model with the new training data. */
+      updateDense(dim, label);
+    }
 
     /* Serialize the model. */
     m_pBinaryOML->save(modelFilePath);
@@ -142,11 +182,36 @@ public:
    */
   int infer(string *pInput, size_t dim)
   {
-    /* Convert inference string input into data vector. */
-    auto data = utility::read_ones<int>(*pInput, dim);
+    /* Convert inference string input into the scratch data vector. */
+    int label;
+    parse(pInput, dim, label);
 
     /* Invoke prediction method and return result. */
-    return m_pBinaryOML->predict(data.second);
+    return m_pBinaryOML->predict(m_sparseFeature);
+  }
+
+  /**
+   * Train the model with a pre-parsed sparse feature, in O(nnz).
+   */
+  void train(const Eigen::SparseVector<double>& feature, const int label)
+  {
+    m_pBinaryOML->update(feature, label);
+  }
+
+  /**
+   * Infer/predict the label of a pre-parsed sparse feature, in O(nnz).
+   */
+  int infer(const Eigen::SparseVector<double>& feature)
+  {
+    return m_pBinaryOML->predict(feature);
+  }
+
+  /**
+   * Apply the examples still held by a mini-batch model, e.g. at the end of the training data.
+   */
+  void flush()
+  {
+    m_pBinaryOML->flush();
   }
 
   /**
@@ -164,6 +229,46 @@ public:
   {
     m_pBinaryOML->save(modelFilePath);
   }
+
+private:
+  /**
+   * Parse the input into the scratch sparse vector. Returns false for blank and comment lines,
+   * which leave the scratch vector as the zero vector rather than the previous line's feature.
+   */
+  bool parse(string *pInput, size_t dim, int& label)
+  {
+    label = 0;
+    if (utility::parse_svmlight_line(*pInput, dim, label, m_sparseFeature)) { return true; }
+
+    m_sparseFeature.resize(dim);
+    m_sparseFeature.setZero();
+    return false;
+  }
+
+  /**
+   * Update the model on the dense form of the scratch sparse vector. Only the stored
+   * coordinates are written into the dense buffer and they are cleared again afterwards,
+   * which keeps the dense update semantics without allocating per call.
+   */
+  void updateDense(size_t dim, int label)
+  {
+    if (static_cast<size_t>(m_denseFeature.size()) != dim)
+    {
+      m_denseFeature = Eigen::VectorXd::Zero(dim);
+    }
+
+    for (Eigen::SparseVector<double>::InnerIterator it(m_sparseFeature); it; ++it)
+    {
+      m_denseFeature[it.index()] = it.value();
+    }
+
+    m_pBinaryOML->update(m_denseFeature, label);
+
+    for (Eigen::SparseVector<double>::InnerIterator it(m_sparseFeature); it; ++it)
+    {
+      m_denseFeature[it.index()] = 0.0;
+    }
+  }
 };
 
 /**
@@ -180,9 +285,9 @@ class BinaryADAGRADRDACreator : public BinaryOMLCreator
 public:
   virtual ~BinaryADAGRADRDACreator() {}
 
-  /* The BinaryOML creator for ADAGRAD RDA. */
-  BinaryADAGRADRDACreator(const size_t dim, const double eta, const double lambda)
-    : BinaryOMLCreator(new ADAGRAD_RDA(dim, eta, lambda)) { }
+  /* The BinaryOML creator for ADAGRAD RDA. With batchSize > 1 one update is applied per mini-batch of batchSize examples. */
+  BinaryADAGRADRDACreator(const size_t dim, const double eta, const double lambda, const size_t batchSize = 1)
+    : BinaryOMLCreator(new ADAGRAD_RDA(dim, eta, lambda, batchSize)) { }
 };
 
 
@@ -195,9 +300,9 @@ class BinaryADAMCreator : public BinaryOMLCreator
 public:
   virtual ~BinaryADAMCreator() {};
 
-  /* The BinaryOML creator for ADAM. */
-  BinaryADAMCreator(const size_t dim)
-    : BinaryOMLCreator(new ADAM(dim)) { }
+  /* The BinaryOML creator for ADAM. With batchSize > 1 one update is applied per mini-batch of batchSize examples. */
+  BinaryADAMCreator(const size_t dim, const size_t batchSize = 1)
+    : BinaryOMLCreator(new ADAM(dim, batchSize)) { }
 };
 
 /** 
@@ -0,0 +1,212 @@
+/**
+ * Streaming parse/train pipeline for any BinaryOMLCreator.
+ *
+ * One thread reads svmlight lines from a file descriptor (stdin, a pipe...) and parses them
+ * into the preallocated slots of a lock-free SPSC ring; the thread calling run() trains the
+ * creator's model on the slots in arrival order. No memory is allocated per example once the
+ * slots have grown to the largest example. When the ring is full the reader waits for the
+ * trainer (back-pressure), and the stall counters tell which side is the bottleneck. A side
+ * that has to wait spins for a short while and then sleeps on a condition variable, so an
+ * idle input does not keep a core busy.
+ */
+
+#ifndef MOCHIMOCHI_BINARY_OML_PIPELINE_HPP_
+#define MOCHIMOCHI_BINARY_OML_PIPELINE_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "binary_oml_factory.hpp"
+#include "../../utility/fd_line_reader.hpp"
+#include "../../utility/parse_svmlight.hpp"
+#include "../../utility/spsc_ring.hpp"
+
+using namespace std;
+
+class BinaryOMLPipeline
+{
+public:
+  /**
+   * Snapshot of the pipeline counters.
+   */
+  struct Stats
+  {
+    size_t parsed;          /* examples published by the reader */
+    size_t trained;         /* examples consumed by the trainer */
+    size_t depth;           /* examples waiting in the ring */
+    size_t producerStalls;  /* times the reader found the ring full */
+    size_t consumerStalls;  /* times the trainer found the ring empty */
+  };
+
+private:
+  /* Yields before a waiting side sleeps on the condition variable. */
+  static constexpr int kSpin = 4096;
+
+private:
+  BinaryOMLCreator& m_creator;
+  const int m_fd;
+  const size_t m_dim;
+
+  utility::SpscRing<utility::Example<int>> m_ring;
+  atomic<bool> m_done;
+  atomic<bool> m_stop;
+  atomic<int> m_sleepers;
+  mutex m_mutex;
+  condition_variable m_wakeup;
+  atomic<size_t> m_parsed;
+  atomic<size_t> m_trained;
+  atomic<size_t> m_producerStalls;
+  atomic<size_t> m_consumerStalls;
+
+public:
+  /* The constructor: the ring holds at least `capacity` examples. */
+  BinaryOMLPipeline(BinaryOMLCreator& creator, const int fd, const size_t dim, const size_t capacity = 1024)
+    : m_creator(creator),
+      m_fd(fd),
+      m_dim(dim),
+      m_ring(capacity),
+      m_done(false),
+      m_stop(false),
+      m_sleepers(0),
+      m_parsed(0),
+      m_trained(0),
+      m_producerStalls(0),
+      m_consumerStalls(0) { }
+
+  virtual ~BinaryOMLPipeline() { }
+
+  /**
+   * Read and train until the end of the input. Returns the number of examples trained.
+   * An error raised by the reader thread is rethrown here. If training throws, the reader is
+   * stopped and joined before the exception is rethrown; a read in progress on the input is
+   * waited for.
+   */
+  size_t run()
+  {
+    m_done.store(false);
+    m_stop.store(false);
+    exception_ptr error;
+
+    thread reader([&] {
+      try
+      {
+        utility::FdLineReader lines(m_fd);
+        pair<const char*, const char*> line;
+        while (!m_stop.load(memory_order_relaxed) && lines.next(line))
+        {
+          utility::Example<int>* slot = m_ring.back();
+          if (slot == nullptr)
+          {
+            m_producerStalls.fetch_add(1, memory_order_relaxed);
+            waitUntil([&] { return (slot = m_ring.back()) != nullptr || m_stop.load(memory_order_acquire); });
+            if (slot == nullptr) { break; }
+          }
+          if (utility::parse_svmlight_line(line.first, line.second, m_dim, *slot))
+          {
+            m_ring.push();
+            m_parsed.fetch_add(1, memory_order_relaxed);
+            wake();
+          }
+        }
+      }
+      catch (...)
+      {
+        error = current_exception();
+      }
+      m_done.store(true, memory_order_release);
+      wake();
+    });
+
+    size_t trained = 0;
+    try
+    {
+      while (true)
+      {
+        utility::Example<int>* slot = m_ring.front();
+        if (slot == nullptr)
+        {
+          m_consumerStalls.fetch_add(1, memory_order_relaxed);
+          /* The reader may have published its last examples just before finishing. */
+          waitUntil([&] { return (slot = m_ring.front()) != nullptr || m_done.load(memory_order_acquire); });
+          if (slot == nullptr && (slot = m_ring.front()) == nullptr) { break; }
+        }
+
+        m_creator.train(slot->feature, slot->label);
+        m_ring.pop();
+        wake();
+        m_trained.fetch_add(1, memory_order_relaxed);
+        ++trained;
+      }
+    }
+    catch (...)
+    {
+      m_stop.store(true, memory_order_release);
+      wake();
+      reader.join();
+      throw;
+    }
+
+    reader.join();
+    m_creator.flush();
+    if (error) { rethrow_exception(error); }
+    return trained;
+  }
+
+  /**
+   * Current counters; safe to call from another thread while run() is in progress.
+   */
+  Stats stats() const
+  {
+    Stats stats;
+    stats.parsed = m_parsed.load(memory_order_relaxed);
+    stats.trained = m_trained.load(memory_order_relaxed);
+    stats.depth = m_ring.size();
+    stats.producerStalls = m_producerStalls.load(memory_order_relaxed);
+    stats.consumerStalls = m_consumerStalls.load(memory_order_relaxed);
+    return stats;
+  }
+
+private:
+  /**
+   * Spins for a while, then sleeps until ready() holds. The other side calls wake() after
+   * each change that can make ready() true.
+   */
+  template <typename PredicateT>
+  void waitUntil(const PredicateT& ready)
+  {
+    for (int spin = 0; spin < kSpin; ++spin)
+    {
+      if (ready()) { return; }
+      this_thread::yield();
+    }
+
+    m_sleepers.fetch_add(1, memory_order_seq_cst);
+    atomic_thread_fence(memory_order_seq_cst);
+    {
+      unique_lock<mutex> lock(m_mutex);
+      m_wakeup.wait(lock, ready);
+    }
+    m_sleepers.fetch_sub(1, memory_order_relaxed);
+  }
+
+  /*
+   * Only takes the lock when a side is asleep. The fences pair with waitUntil: either the
+   * sleeper sees the change before it sleeps, or this sees the sleeper and notifies it.
+   */
+  void wake()
+  {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (m_sleepers.load(memory_order_relaxed) != 0)
+    {
+      {
+        lock_guard<mutex> lock(m_mutex);
+      }
+      m_wakeup.notify_all();
+    }
+  }
+};
+
+#endif // MOCHIMOCHI_BINARY_OML_PIPELINE_HPP_
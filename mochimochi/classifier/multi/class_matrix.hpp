@@ -0,0 +1,111 @@
+#ifndef MOCHIMOCHI_CLASS_MATRIX_HPP_
+#define MOCHIMOCHI_CLASS_MATRIX_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include <vector>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "../../functions/dot.hpp"
+
+/**
+ * (label, score) pairs of a multi-class prediction, best first.
+ */
+using Ranking = std::vector<std::pair<std::size_t, double>>;
+
+/**
+ * One dim-sized vector per class (the means of every class, their covariances...) stored as
+ * the rows of a single contiguous row major k×dim matrix of ScalarT.
+ *
+ * row(c) is a Map onto class c, which the binary update kernels (arow::update, ...) modify
+ * in place. scores() computes x・row(c) of every class with no copy of the model: one GEMV
+ * for a dense feature, and for a sparse feature one gather of the stored coordinates per
+ * class row.
+ */
+template <typename ScalarT>
+class ClassMatrix {
+public:
+  using Vector = Eigen::Matrix<ScalarT, Eigen::Dynamic, 1>;
+  using Matrix = Eigen::Matrix<ScalarT, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+  using Row = Eigen::Map<Vector>;
+  using ConstRow = Eigen::Map<const Vector>;
+
+private:
+  std::size_t _dim;
+  std::size_t _rows;
+  std::vector<ScalarT> _data;
+
+public:
+  ClassMatrix(const std::size_t dim, const std::size_t rows, const ScalarT value)
+    : _dim(dim),
+      _rows(rows),
+      _data(dim * rows, value) {
+    assert(dim > 0);
+  }
+
+  virtual ~ClassMatrix() { }
+
+public:
+  std::size_t rows() const { return _rows; }
+  std::size_t dim() const { return _dim; }
+
+  Row row(const std::size_t c) {
+    return Row(_data.data() + c * _dim, _dim);
+  }
+
+  ConstRow row(const std::size_t c) const {
+    return ConstRow(_data.data() + c * _dim, _dim);
+  }
+
+  /**
+   * Appends a row filled with value, for a class seen for the first time. The storage grows
+   * geometrically like any std::vector, so adding classes one by one costs amortized O(dim)
+   * each and the existing rows keep their values; Maps from row() taken before are invalidated.
+   */
+  void add_row(const ScalarT value) {
+    _data.resize(_data.size() + _dim, value);
+    ++_rows;
+  }
+
+  Eigen::Map<const Matrix> matrix() const {
+    return Eigen::Map<const Matrix>(_data.data(), _rows, _dim);
+  }
+
+  /**
+   * scores[c] = x・row(c). scores is only reallocated when the number of classes changed.
+   */
+  void scores(const Eigen::VectorXd& x, Eigen::VectorXd& scores) const {
+    // A float matrix is multiplied in float, by a float copy of x (O(dim), not O(k dim)).
+    scores.noalias() = (matrix() * x.template cast<ScalarT>()).template cast<double>();
+  }
+
+  void scores(const Eigen::SparseVector<double>& x, Eigen::VectorXd& scores) const {
+    scores.resize(_rows);
+    for (std::size_t c = 0; c < _rows; ++c) {
+      scores[c] = functions::dot(x, row(c));
+    }
+  }
+
+  /**
+   * The min(k, rows) rows with the highest x・row(c) as (row, score) pairs, best first, ties
+   * to the smaller row as maxCoeff. Every row is scored once straight into top and only the
+   * first k are ordered (partial_sort); top keeps its capacity, so a reused top is not
+   * reallocated.
+   */
+  template <typename FeatureT>
+  void top_rows(const FeatureT& x, const std::size_t k, Ranking& top) const {
+    top.resize(_rows);
+    for (std::size_t c = 0; c < _rows; ++c) {
+      top[c] = std::make_pair(c, functions::dot(x, row(c)));
+    }
+    const auto n = std::min(k, _rows);
+    std::partial_sort(top.begin(), top.begin() + n, top.end(),
+                      [](const std::pair<std::size_t, double>& a, const std::pair<std::size_t, double>& b) {
+                        return a.second > b.second || (a.second == b.second && a.first < b.first);
+                      });
+    top.resize(n);
+  }
+};
+
+#endif //MOCHIMOCHI_CLASS_MATRIX_HPP_
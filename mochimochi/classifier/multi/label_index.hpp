@@ -0,0 +1,45 @@
+#ifndef MOCHIMOCHI_LABEL_INDEX_HPP_
+#define MOCHIMOCHI_LABEL_INDEX_HPP_
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * The labels of a multi-class model and the ClassMatrix rows of their class models. Labels
+ * can be any std::size_t and get the rows 0, 1, ... in the order they are registered, so a
+ * new label appends a row and never moves the rows of the known ones.
+ */
+class LabelIndex {
+private:
+  std::unordered_map<std::size_t, std::size_t> _rows;
+  std::vector<std::size_t> _labels;
+
+public:
+  // Registers the labels 1..n_class as the rows 0..n_class-1.
+  explicit LabelIndex(const std::size_t n_class) {
+    _rows.reserve(n_class);
+    _labels.reserve(n_class);
+    for (std::size_t label = 1; label <= n_class; ++label) { insert(label); }
+  }
+
+  virtual ~LabelIndex() { }
+
+public:
+  std::size_t size() const { return _labels.size(); }
+
+  std::size_t label(const std::size_t row) const { return _labels[row]; }
+
+  const std::vector<std::size_t>& labels() const { return _labels; }
+
+  /**
+   * The row of label, and whether label was new and has just been given the row size() - 1.
+   */
+  std::pair<std::size_t, bool> insert(const std::size_t label) {
+    const auto inserted = _rows.emplace(label, _labels.size());
+    if (inserted.second) { _labels.push_back(label); }
+    return std::make_pair(inserted.first->second, inserted.second);
+  }
+};
+
+#endif //MOCHIMOCHI_LABEL_INDEX_HPP_
@@ -1,45 +1,48 @@
 #ifndef MOCHIMOCHI_MAROW_HPP_
 #define MOCHIMOCHI_MAROW_HPP_
 
-#include <algorithm>
-#include <unordered_map>
-#include <boost/range/irange.hpp>
 #include "../binary/arow.hpp"
+#include "./multi_base.hpp"
+
+// One-vs-rest AROW; ScalarT is the scalar type of the class models (MAROW or MAROWf).
+// The means and covariances of the classes are the rows of two ClassMatrix, so predict is
+// one pass over a contiguous k×dim matrix. Unseen labels add a class (see add_class).
+template <typename ScalarT>
+class BasicMAROW : public OneVsRestBase<BasicMAROW<ScalarT>, ScalarT> {
+  friend class MultiBase<BasicMAROW<ScalarT>, ScalarT>;
 
-class MAROW {
 private:
-  const std::size_t kClass;
+  const double kR;
 
 private:
-  std::unordered_map<std::size_t, AROW> _arows;
+  ClassMatrix<ScalarT> _covariances;
 
 public:
-  MAROW(const std::size_t dim, const std::size_t n_class, const double r)
-    : kClass(n_class) {
-    static_assert(std::numeric_limits<decltype(n_class)>::max() > 2, "Class range Error. (n_class > 2)");
-
-    for (const auto i : boost::irange<std::size_t>(1, kClass + 1)) {
-      _arows.insert(std::pair<std::size_t, AROW>(i, AROW(dim, r)) );
-    }
-  }
+  BasicMAROW(const std::size_t dim, const std::size_t n_class, const double r)
+    : OneVsRestBase<BasicMAROW<ScalarT>, ScalarT>(dim, n_class),
+      kR(r),
+      _covariances(dim, n_class, ScalarT(1)) { }
 
-  virtual ~MAROW() { }
+  virtual ~BasicMAROW() { }
 
-public:
-  void update(const Eigen::VectorXd& feature, const std::size_t label) {
-    for(auto& arow : _arows) {
-      const auto t = (arow.first == label) ? 1 : -1;
-      arow.second.update(feature, t);
-    }
+private:
+  void add_rows() {
+    _covariances.add_row(ScalarT(1));
   }
 
-  std::size_t predict(const Eigen::VectorXd& feature) const {
-    return std::max_element(_arows.begin(), _arows.end(),
-                            [&](const auto& p1, const auto& p2) {
-                              return p1.second.get_means().dot(feature) < p2.second.get_means().dot(feature);
-                            })->first;
+  template <typename FeatureT>
+  void update_with(const FeatureT& feature, const std::size_t y) {
+    this->for_classes([&](const std::size_t first, const std::size_t last) {
+        for (auto c = first; c < last; ++c) {
+          auto means = this->_means.row(c);
+          auto covariances = _covariances.row(c);
+          arow::update(feature, (c == y) ? 1 : -1, means, covariances, kR);
+        }
+      });
   }
-
 };
 
+using MAROW = BasicMAROW<double>;
+using MAROWf = BasicMAROW<float>;
+
 #endif //MOCHIMOCHI_MAROW_HPP_
@@ -0,0 +1,71 @@
+#ifndef MOCHIMOCHI_MCAROW_HPP_
+#define MOCHIMOCHI_MCAROW_HPP_
+
+#include <algorithm>
+#include "../binary/arow.hpp"
+#include "./multi_base.hpp"
+
+/**
+ * Multi-class AROW with a single constraint per example (MCAROW or MCAROWf), after
+ * "Multi-Class Confidence Weighted Algorithms" (Crammer, Dredze and Kulesza, EMNLP 2009).
+ *
+ * Where the one-vs-rest MAROW runs k binary updates per example, MCAROW only updates the
+ * true class y and the wrong class r with the highest score. The constraint is on the
+ * margin μ_y・x - μ_r・x, whose confidence is x^T Σ_y x + x^T Σ_r x. An update is one scoring
+ * pass over the k classes and two O(nnz) row updates.
+ */
+template <typename ScalarT>
+class BasicMCAROW : public MultiBase<BasicMCAROW<ScalarT>, ScalarT> {
+  friend class MultiBase<BasicMCAROW<ScalarT>, ScalarT>;
+
+private:
+  const double kR;
+
+private:
+  ClassMatrix<ScalarT> _covariances;
+  Eigen::VectorXd _scores;
+
+public:
+  BasicMCAROW(const std::size_t dim, const std::size_t n_class, const double r)
+    : MultiBase<BasicMCAROW<ScalarT>, ScalarT>(dim, n_class),
+      kR(r),
+      _covariances(dim, n_class, ScalarT(1)) {
+    assert(r > 0);
+  }
+
+  virtual ~BasicMCAROW() { }
+
+private:
+  void add_rows() {
+    _covariances.add_row(ScalarT(1));
+  }
+
+  template <typename FeatureT>
+  void update_with(const FeatureT& feature, const std::size_t y) {
+    if (this->_labels.size() < 2) { return; }
+
+    this->_means.scores(feature, _scores);
+    const auto r = this->rival(_scores, y);
+
+    auto means_y = this->_means.row(y);
+    auto covariances_y = _covariances.row(y);
+    auto means_r = this->_means.row(r);
+    auto covariances_r = _covariances.row(r);
+
+    // Most examples stop at the margin check, so the covariances are only read on a violation.
+    const auto margin = _scores[y] - _scores[r];
+    if (margin >= 1.0) { return; }
+
+    const auto confidence = functions::confidence(feature, covariances_y) + functions::confidence(feature, covariances_r);
+    const auto beta = 1.0 / (confidence + kR);
+    const auto alpha = std::max(0.0, 1.0 - margin) * beta;
+
+    functions::update_means_and_covariances(feature, means_y, covariances_y, alpha, beta);
+    functions::update_means_and_covariances(feature, means_r, covariances_r, -alpha, beta);
+  }
+};
+
+using MCAROW = BasicMCAROW<double>;
+using MCAROWf = BasicMCAROW<float>;
+
+#endif //MOCHIMOCHI_MCAROW_HPP_
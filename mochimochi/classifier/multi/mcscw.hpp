@@ -0,0 +1,71 @@
+#ifndef MOCHIMOCHI_MCSCW_HPP_
+#define MOCHIMOCHI_MCSCW_HPP_
+
+#include "../binary/scw.hpp"
+#include "./multi_base.hpp"
+
+/**
+ * Multi-class SCW with a single constraint per example (MCSCW or MCSCWf). Like MCAROW, it
+ * only updates the true class y and the wrong class r with the highest score. The SCW loss,
+ * alpha and beta are computed on the margin μ_y・x - μ_r・x and its confidence
+ * x^T Σ_y x + x^T Σ_r x.
+ */
+template <typename ScalarT>
+class BasicMCSCW : public MultiBase<BasicMCSCW<ScalarT>, ScalarT> {
+  friend class MultiBase<BasicMCSCW<ScalarT>, ScalarT>;
+
+private:
+  const double kC;
+  const double kPhi;
+
+private:
+  ClassMatrix<ScalarT> _covariances;
+  Eigen::VectorXd _scores;
+
+public:
+  BasicMCSCW(const std::size_t dim, const std::size_t n_class, const double c, const double eta)
+    : MultiBase<BasicMCSCW<ScalarT>, ScalarT>(dim, n_class),
+      kC(c),
+      kPhi(scw::cdf(eta)),
+      _covariances(dim, n_class, ScalarT(1)) {
+    assert(c > 0);
+    assert(eta > 0);
+  }
+
+  virtual ~BasicMCSCW() { }
+
+private:
+  void add_rows() {
+    _covariances.add_row(ScalarT(1));
+  }
+
+  template <typename FeatureT>
+  void update_with(const FeatureT& feature, const std::size_t y) {
+    if (this->_labels.size() < 2) { return; }
+
+    this->_means.scores(feature, _scores);
+    const auto r = this->rival(_scores, y);
+
+    auto means_y = this->_means.row(y);
+    auto covariances_y = _covariances.row(y);
+    auto means_r = this->_means.row(r);
+    auto covariances_r = _covariances.row(r);
+
+    const auto m = _scores[y] - _scores[r];
+    const auto v = functions::confidence(feature, covariances_y) + functions::confidence(feature, covariances_r);
+    if (scw::suffer_loss(m, v, kPhi) <= 0.0) { return; }
+
+    const auto n = v + 1.0 / 2.0 * kC;
+    const auto ganma = kPhi * std::sqrt(kPhi * kPhi * m * m * v * v + 4.0 * n * v * (n + v * kPhi * kPhi));
+    const auto alpha = scw::compute_alpha(m, n, v, ganma, kC, kPhi);
+    const auto beta = scw::compute_beta(alpha, ganma, kPhi);
+
+    functions::update_means_and_covariances(feature, means_y, covariances_y, alpha, beta);
+    functions::update_means_and_covariances(feature, means_r, covariances_r, -alpha, beta);
+  }
+};
+
+using MCSCW = BasicMCSCW<double>;
+using MCSCWf = BasicMCSCW<float>;
+
+#endif //MOCHIMOCHI_MCSCW_HPP_
@@ -1,45 +1,59 @@
 #ifndef MOCHIMOCHI_MNHERD_HPP_
 #define MOCHIMOCHI_MNHERD_HPP_
 
-#include <algorithm>
-#include <unordered_map>
-#include <boost/range/irange.hpp>
+#include <stdexcept>
 #include "../binary/nherd.hpp"
+#include "./multi_base.hpp"
+
+// One-vs-rest NHERD; ScalarT is the scalar type of the class models (MNHERD or MNHERDf).
+// The means and covariances of the classes are the rows of two ClassMatrix, so predict is
+// one pass over a contiguous k×dim matrix. Unseen labels add a class (see add_class).
+template <typename ScalarT>
+class BasicMNHERD : public OneVsRestBase<BasicMNHERD<ScalarT>, ScalarT> {
+  friend class MultiBase<BasicMNHERD<ScalarT>, ScalarT>;
 
-class MNHERD {
 private:
-  const std::size_t kClass;
+  const double kC;
+  const int kDiagonal;
 
 private:
-  std::unordered_map<std::size_t, NHERD> _nherds;
+  ClassMatrix<ScalarT> _covariances;
 
 public:
-  MNHERD(const std::size_t dim, const std::size_t n_class, const double C, const int diagonal = 0)
-    : kClass(n_class) {
-    static_assert(std::numeric_limits<decltype(n_class)>::max() > 2, "Class range Error. (n_class > 2)");
-
-    for (const auto i : boost::irange<std::size_t>(1, kClass + 1)) {
-      _nherds.insert(std::pair<std::size_t, NHERD>(i, NHERD(dim, C, diagonal)) );
+  BasicMNHERD(const std::size_t dim, const std::size_t n_class, const double C, const int diagonal = 0)
+    : OneVsRestBase<BasicMNHERD<ScalarT>, ScalarT>(dim, n_class),
+      kC(C),
+      kDiagonal(diagonal),
+      _covariances(dim, n_class, ScalarT(1)) {
+
+    if (diagonal < 0 || diagonal > 3) {
+      throw std::runtime_error("Error in switching the diagonal covariance.");
     }
   }
 
-  virtual ~MNHERD() { }
+  virtual ~BasicMNHERD() { }
 
-public:
-  void update(const Eigen::VectorXd& feature, const std::size_t label) {
-    for(auto& nherd : _nherds) {
-      const auto t = (nherd.first == label) ? 1 : -1;
-      nherd.second.update(feature, t);
-    }
+private:
+  void add_rows() {
+    _covariances.add_row(ScalarT(1));
   }
 
-  std::size_t predict(const Eigen::VectorXd& feature) const {
-    return std::max_element(_nherds.begin(), _nherds.end(),
-                            [&](const auto& p1, const auto& p2) {
-                              return p1.second.get_means().dot(feature) < p2.second.get_means().dot(feature);
-                            })->first;
+  template <typename FeatureT>
+  void update_with(const FeatureT& feature, const std::size_t y) {
+    nherd::dispatch(kDiagonal, [&](auto policy) {
+        this->for_classes([&](const std::size_t first, const std::size_t last) {
+            for (auto c = first; c < last; ++c) {
+              auto means = this->_means.row(c);
+              auto covariances = _covariances.row(c);
+              nherd::update<decltype(policy)>(feature, (c == y) ? 1 : -1, means, covariances, kC);
+            }
+          });
+        return true;
+      });
   }
-
 };
 
+using MNHERD = BasicMNHERD<double>;
+using MNHERDf = BasicMNHERD<float>;
+
 #endif //MOCHIMOCHI_NHERD_HPP_
@@ -1,45 +1,50 @@
 #ifndef MOCHIMOCHI_MPA_HPP_
 #define MOCHIMOCHI_MPA_HPP_
 
-#include <algorithm>
-#include <unordered_map>
-#include <boost/range/irange.hpp>
+#include <stdexcept>
 #include "../binary/pa.hpp"
+#include "./multi_base.hpp"
 
-class MPA {
-private:
-  const std::size_t kClass;
+// One-vs-rest PA; ScalarT is the scalar type of the class models (MPA or MPAf).
+// The weights of the classes are the rows of a ClassMatrix (_means of MultiBase), so predict
+// is one pass over a contiguous k×dim matrix. Unseen labels add a class (see add_class).
+template <typename ScalarT>
+class BasicMPA : public OneVsRestBase<BasicMPA<ScalarT>, ScalarT> {
+  friend class MultiBase<BasicMPA<ScalarT>, ScalarT>;
 
 private:
-  std::unordered_map<std::size_t, PA> _pas;
+  const double kC;
+  const int kSelect;
 
 public:
-  MPA(const std::size_t dim, const std::size_t n_class, const double C, const int select = 2)
-    : kClass(n_class) {
-    static_assert(std::numeric_limits<decltype(n_class)>::max() > 2, "Class range Error. (n_class > 2)");
+  BasicMPA(const std::size_t dim, const std::size_t n_class, const double C, const int select = 2)
+    : OneVsRestBase<BasicMPA<ScalarT>, ScalarT>(dim, n_class),
+      kC(C),
+      kSelect(select) {
 
-    for (const auto i : boost::irange<std::size_t>(1, kClass + 1)) {
-      _pas.insert(std::pair<std::size_t, PA>(i, PA(dim, C, select)) );
+    if (select < 0 || select > 2) {
+      throw std::runtime_error("Error in the PA algorithm.");
     }
   }
 
-  virtual ~MPA() { }
-
-public:
-  void update(const Eigen::VectorXd& feature, const std::size_t label) {
-    for(auto& pa : _pas) {
-      const auto t = (pa.first == label) ? 1 : -1;
-      pa.second.update(feature, t);
-    }
-  }
+  virtual ~BasicMPA() { }
 
-  std::size_t predict(const Eigen::VectorXd& feature) const {
-    return std::max_element(_pas.begin(), _pas.end(),
-                            [&](const auto& p1, const auto& p2) {
-                              return p1.second.get_weight().dot(feature) < p2.second.get_weight().dot(feature);
-                            })->first;
+private:
+  template <typename FeatureT>
+  void update_with(const FeatureT& feature, const std::size_t y) {
+    pa::dispatch(kSelect, [&](auto variant) {
+        this->for_classes([&](const std::size_t first, const std::size_t last) {
+            for (auto c = first; c < last; ++c) {
+              auto weight = this->_means.row(c);
+              pa::update<decltype(variant)>(feature, (c == y) ? 1 : -1, weight, kC);
+            }
+          });
+        return true;
+      });
   }
-
 };
 
+using MPA = BasicMPA<double>;
+using MPAf = BasicMPA<float>;
+
 #endif //MOCHIMOCHI_MPA_HPP_
@@ -1,45 +1,50 @@
 #ifndef MOCHIMOCHI_MSCW_HPP_
 #define MOCHIMOCHI_MSCW_HPP_
 
-#include <algorithm>
-#include <unordered_map>
-#include <boost/range/irange.hpp>
 #include "../binary/scw.hpp"
+#include "./multi_base.hpp"
+
+// One-vs-rest SCW; ScalarT is the scalar type of the class models (MSCW or MSCWf).
+// The means and covariances of the classes are the rows of two ClassMatrix, so predict is
+// one pass over a contiguous k×dim matrix. Unseen labels add a class (see add_class).
+template <typename ScalarT>
+class BasicMSCW : public OneVsRestBase<BasicMSCW<ScalarT>, ScalarT> {
+  friend class MultiBase<BasicMSCW<ScalarT>, ScalarT>;
 
-class MSCW {
 private:
-  const std::size_t kClass;
+  const double kC;
+  const double kPhi;
 
 private:
-  std::unordered_map<std::size_t, SCW> _scws;
+  ClassMatrix<ScalarT> _covariances;
 
 public:
-  MSCW(const std::size_t dim, const std::size_t n_class, const double c, const double eta)
-    : kClass(n_class) {
-    static_assert(std::numeric_limits<decltype(n_class)>::max() > 2, "Class range Error. (n_class > 2)");
-
-    for (const auto i : boost::irange<std::size_t>(1, kClass + 1)) {
-      _scws.insert(std::pair<std::size_t, SCW>(i, SCW(dim, c, eta)) );
-    }
-  }
+  BasicMSCW(const std::size_t dim, const std::size_t n_class, const double c, const double eta)
+    : OneVsRestBase<BasicMSCW<ScalarT>, ScalarT>(dim, n_class),
+      kC(c),
+      kPhi(scw::cdf(eta)),
+      _covariances(dim, n_class, ScalarT(1)) { }
 
-  virtual ~MSCW() { }
+  virtual ~BasicMSCW() { }
 
-public:
-  void update(const Eigen::VectorXd& feature, const std::size_t label) {
-    for(auto& scw : _scws) {
-      const auto t = (scw.first == label) ? 1 : -1;
-      scw.second.update(feature, t);
-    }
+private:
+  void add_rows() {
+    _covariances.add_row(ScalarT(1));
   }
 
-  std::size_t predict(const Eigen::VectorXd& feature) const {
-    return std::max_element(_scws.begin(), _scws.end(),
-                            [&](const auto& p1, const auto& p2) {
-                              return p1.second.get_means().dot(feature) < p2.second.get_means().dot(feature);
-                            })->first;
+  template <typename FeatureT>
+  void update_with(const FeatureT& feature, const std::size_t y) {
+    this->for_classes([&](const std::size_t first, const std::size_t last) {
+        for (auto c = first; c < last; ++c) {
+          auto means = this->_means.row(c);
+          auto covariances = _covariances.row(c);
+          scw::update(feature, (c == y) ? 1 : -1, means, covariances, kC, kPhi);
+        }
+      });
   }
-
 };
 
+using MSCW = BasicMSCW<double>;
+using MSCWf = BasicMSCW<float>;
+
 #endif //MOCHIMOCHI_MSCW_HPP_
@@ -0,0 +1,176 @@
+#ifndef MOCHIMOCHI_MULTI_BASE_HPP_
+#define MOCHIMOCHI_MULTI_BASE_HPP_
+
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "../../utility/thread_pool.hpp"
+#include "./class_matrix.hpp"
+#include "./label_index.hpp"
+
+/**
+ * Labels, registration of new classes, predict and predict_topk shared by the multi-class
+ * classifiers, which only implement their update kernel. DerivedT is the classifier (CRTP):
+ *
+ *   DerivedT::update_with(feature, y)  updates the class models for an example of row y;
+ *   DerivedT::add_rows()               appends the rows of a new class to the models the
+ *                                      classifier adds to _means (its covariances...).
+ *
+ * _means holds the rows that predict scores: the means of the CW classifiers and the
+ * weights of MPA.
+ */
+template <typename DerivedT, typename ScalarT>
+class MultiBase {
+protected:
+  LabelIndex _labels;
+  ClassMatrix<ScalarT> _means;
+
+protected:
+  MultiBase(const std::size_t dim, const std::size_t n_class)
+    : _labels(n_class),
+      _means(dim, n_class, ScalarT(0)) {
+    static_assert(std::numeric_limits<decltype(n_class)>::max() > 2, "Class range Error. (n_class > 2)");
+  }
+
+public:
+  virtual ~MultiBase() { }
+
+protected:
+  // No other model than _means.
+  void add_rows() { }
+
+  // The row of label, appending the initial model of a class seen for the first time; the
+  // models of the known classes are left as they are.
+  std::size_t row_of(const std::size_t label) {
+    const auto inserted = _labels.insert(label);
+    if (inserted.second) {
+      _means.add_row(ScalarT(0));
+      static_cast<DerivedT*>(this)->add_rows();
+    }
+    return inserted.first;
+  }
+
+  // The wrong class with the highest score.
+  std::size_t rival(const Eigen::VectorXd& scores, const std::size_t y) const {
+    std::size_t r = (y == 0) ? 1 : 0;
+    for (std::size_t c = r + 1; c < _labels.size(); ++c) {
+      if (c != y && scores[c] > scores[r]) { r = c; }
+    }
+    return r;
+  }
+
+private:
+  template <typename FeatureT>
+  std::size_t predict_with(const FeatureT& feature) const {
+    if (_labels.size() == 0) {
+      throw std::runtime_error("No class has been registered.");
+    }
+    Eigen::VectorXd scores;
+    _means.scores(feature, scores);
+    Eigen::Index c;
+    scores.maxCoeff(&c);
+    return _labels.label(c);
+  }
+
+  template <typename FeatureT>
+  void predict_topk_with(const FeatureT& feature, const std::size_t k, Ranking& top) const {
+    _means.top_rows(feature, k, top);
+    for (auto& entry : top) { entry.first = _labels.label(entry.first); }
+  }
+
+public:
+  /**
+   * Registers label, as update() does the first time it sees a label; the constructor
+   * registers 1..n_class. A new class starts from the initial model and the models of the
+   * known classes are not touched.
+   */
+  void add_class(const std::size_t label) {
+    row_of(label);
+  }
+
+  // The registered labels, in the order they were added.
+  const std::vector<std::size_t>& labels() const {
+    return _labels.labels();
+  }
+
+  void update(const Eigen::VectorXd& feature, const std::size_t label) {
+    static_cast<DerivedT*>(this)->update_with(feature, row_of(label));
+  }
+
+  void update(const Eigen::SparseVector<double>& feature, const std::size_t label) {
+    static_cast<DerivedT*>(this)->update_with(feature, row_of(label));
+  }
+
+  std::size_t predict(const Eigen::VectorXd& feature) const {
+    return predict_with(feature);
+  }
+
+  std::size_t predict(const Eigen::SparseVector<double>& feature) const {
+    return predict_with(feature);
+  }
+
+  /**
+   * The k best labels of feature with their scores, best first, from one scoring pass; top
+   * is overwritten and reusing it across calls does not allocate.
+   */
+  void predict_topk(const Eigen::VectorXd& feature, const std::size_t k, Ranking& top) const {
+    predict_topk_with(feature, k, top);
+  }
+
+  void predict_topk(const Eigen::SparseVector<double>& feature, const std::size_t k, Ranking& top) const {
+    predict_topk_with(feature, k, top);
+  }
+
+  Ranking predict_topk(const Eigen::VectorXd& feature, const std::size_t k) const {
+    Ranking top;
+    predict_topk_with(feature, k, top);
+    return top;
+  }
+
+  Ranking predict_topk(const Eigen::SparseVector<double>& feature, const std::size_t k) const {
+    Ranking top;
+    predict_topk_with(feature, k, top);
+    return top;
+  }
+};
+
+/**
+ * MultiBase of the one-vs-rest classifiers, whose update runs one binary update per class
+ * and can split the classes over a thread pool (see set_threads).
+ */
+template <typename DerivedT, typename ScalarT>
+class OneVsRestBase : public MultiBase<DerivedT, ScalarT> {
+private:
+  std::unique_ptr<utility::ThreadPool> _pool;
+
+protected:
+  OneVsRestBase(const std::size_t dim, const std::size_t n_class)
+    : MultiBase<DerivedT, ScalarT>(dim, n_class) { }
+
+public:
+  virtual ~OneVsRestBase() { }
+
+protected:
+  // Calls f(first, last) on the classes [0, k), split over the threads of the pool if any.
+  template <typename FunctionT>
+  void for_classes(const FunctionT& f) {
+    if (_pool) {
+      _pool->parallel_for(this->_labels.size(), f);
+    } else {
+      f(std::size_t(0), this->_labels.size());
+    }
+  }
+
+public:
+  /**
+   * Run the k one-vs-rest updates of each example on n_threads threads (the caller
+   * included), each thread updating its own contiguous range of classes; the feature is
+   * shared read-only. 1, the default, updates the classes serially.
+   */
+  void set_threads(const std::size_t n_threads) {
+    _pool.reset(n_threads > 1 ? new utility::ThreadPool(n_threads) : nullptr);
+  }
+};
+
+#endif //MOCHIMOCHI_MULTI_BASE_HPP_
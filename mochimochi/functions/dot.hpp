@@ -0,0 +1,66 @@
+#ifndef MOCHIMOCHI_FUNCTIONS_DOT_HPP_
+#define MOCHIMOCHI_FUNCTIONS_DOT_HPP_
+
+#include <stdexcept>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+namespace functions {
+  // x・w for a double feature and a model vector (or expression) of any scalar type: a float
+  // model is read at its own width and accumulated in double. With a double model this is
+  // the plain Eigen dot product.
+  template <typename DerivedT, typename VectorT>
+  double dot(const Eigen::MatrixBase<DerivedT>& feature, const VectorT& vector) {
+    return feature.dot(vector.template cast<double>());
+  }
+
+  template <typename ScalarT, int OptionsT, typename IndexT, typename VectorT>
+  double dot(const Eigen::SparseVector<ScalarT, OptionsT, IndexT>& feature, const VectorT& vector) {
+    const auto indices = feature.innerIndexPtr();
+    const auto values = feature.valuePtr();
+    const auto nnz = feature.nonZeros();
+    auto result = 0.0;
+    for (auto i = decltype(nnz)(0); i < nnz; ++i) {
+      result += values[i] * vector[indices[i]];
+    }
+    return result;
+  }
+
+  // Throws unless the examples of a batch have the dimension of the model; checked once per
+  // batch, since the row loops index the model with the stored coordinates unchecked.
+  inline void check_batch_dim(const std::size_t cols, const std::size_t dim) {
+    if (cols != dim) {
+      throw std::runtime_error("The dimension of the batch does not match the model.");
+    }
+  }
+
+  // X w for the examples stored in the rows of X.
+  template <typename VectorT>
+  Eigen::VectorXd dot_rows(const Eigen::MatrixXd& X, const VectorT& vector) {
+    check_batch_dim(X.cols(), vector.size());
+    return X * vector.template cast<double>();
+  }
+
+  template <int OptionsT, typename IndexT, typename VectorT>
+  Eigen::VectorXd dot_rows(const Eigen::SparseMatrix<double, OptionsT, IndexT>& X, const VectorT& vector) {
+    static_assert(OptionsT & Eigen::RowMajor, "dot_rows takes a row major (CSR) matrix.");
+    check_batch_dim(X.cols(), vector.size());
+    const auto offsets = X.outerIndexPtr();
+    const auto indices = X.innerIndexPtr();
+    const auto values = X.valuePtr();
+    const auto counts = X.innerNonZeroPtr();
+    Eigen::VectorXd result(X.rows());
+    for (auto row = decltype(X.rows())(0); row < X.rows(); ++row) {
+      const auto first = offsets[row];
+      const auto last = counts == nullptr ? offsets[row + 1] : first + counts[row];
+      auto margin = 0.0;
+      for (auto i = first; i < last; ++i) {
+        margin += values[i] * vector[indices[i]];
+      }
+      result[row] = margin;
+    }
+    return result;
+  }
+};
+
+#endif //MOCHIMOCHI_FUNCTIONS_DOT_HPP_
@@ -2,6 +2,8 @@
 #define MOCHIMOCHI_FUNCTIONS_ENUMERATE_HPP_
 
 #include <vector>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
 
 namespace functions {
   template <typename IteratorT, typename FunctionT>
@@ -16,6 +18,25 @@ namespace functions {
 
     return func;
   }
+
+  // Visits every coordinate of a dense vector as (index, value).
+  template <typename DerivedT, typename FunctionT>
+  FunctionT enumerate(const Eigen::MatrixBase<DerivedT>& vector, FunctionT func) {
+    return enumerate(vector.derived().data(), vector.derived().data() + vector.size(), 0, func);
+  }
+
+  // Visits only the stored coordinates of a sparse vector as (index, value).
+  template <typename ScalarT, int OptionsT, typename IndexT, typename FunctionT>
+  FunctionT enumerate(const Eigen::SparseVector<ScalarT, OptionsT, IndexT>& vector, FunctionT func) {
+    const auto indices = vector.innerIndexPtr();
+    const auto values = vector.valuePtr();
+    const auto nnz = vector.nonZeros();
+    for (auto i = decltype(nnz)(0); i < nnz; ++i) {
+      func(indices[i], values[i]);
+    }
+
+    return func;
+  }
 };
 
 #endif //MOCHIMOCHI_FUNCTIONS_ENUMERATE_HPP_
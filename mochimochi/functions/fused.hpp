@@ -0,0 +1,107 @@
+#ifndef MOCHIMOCHI_FUNCTIONS_FUSED_HPP_
+#define MOCHIMOCHI_FUNCTIONS_FUSED_HPP_
+
+#include <algorithm>
+#include <utility>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+// Kernels of the confidence-weighted learners (AROW, SCW, NHERD), which keep a mean vector
+// and a diagonal covariance. Each kernel reads the feature and the model state once. The
+// model vectors may be float or double; the feature is double and sums are kept in double.
+namespace functions {
+  // Dense vectors are processed in blocks that stay in L1, so the two Eigen reductions of a
+  // block cost one pass over memory and are still vectorized.
+  constexpr Eigen::Index kFusedBlock = 512;
+
+  // Returns (x・μ, Σ σ_i x_i^2) in one pass.
+  template <typename DerivedT, typename VectorT>
+  std::pair<double, double> margin_and_confidence(const Eigen::MatrixBase<DerivedT>& feature,
+                                                  const VectorT& means,
+                                                  const VectorT& covariances) {
+    const auto& x = feature.derived();
+    auto margin = 0.0;
+    auto confidence = 0.0;
+    for (Eigen::Index i = 0; i < x.size(); i += kFusedBlock) {
+      const auto size = std::min(kFusedBlock, x.size() - i);
+      const auto block = x.segment(i, size);
+      margin += block.dot(means.segment(i, size).template cast<double>());
+      confidence += block.cwiseAbs2().dot(covariances.segment(i, size).template cast<double>());
+    }
+    return std::make_pair(margin, confidence);
+  }
+
+  template <typename ScalarT, int OptionsT, typename IndexT, typename VectorT>
+  std::pair<double, double> margin_and_confidence(const Eigen::SparseVector<ScalarT, OptionsT, IndexT>& feature,
+                                                  const VectorT& means,
+                                                  const VectorT& covariances) {
+    const auto indices = feature.innerIndexPtr();
+    const auto values = feature.valuePtr();
+    const auto nnz = feature.nonZeros();
+    auto margin = 0.0;
+    auto confidence = 0.0;
+    for (auto i = decltype(nnz)(0); i < nnz; ++i) {
+      const auto index = indices[i];
+      const auto value = values[i];
+      margin += means[index] * value;
+      confidence += covariances[index] * value * value;
+    }
+    return std::make_pair(margin, confidence);
+  }
+
+  // Returns Σ σ_i x_i^2.
+  template <typename DerivedT, typename VectorT>
+  double confidence(const Eigen::MatrixBase<DerivedT>& feature, const VectorT& covariances) {
+    return feature.cwiseAbs2().dot(covariances.template cast<double>());
+  }
+
+  template <typename ScalarT, int OptionsT, typename IndexT, typename VectorT>
+  double confidence(const Eigen::SparseVector<ScalarT, OptionsT, IndexT>& feature, const VectorT& covariances) {
+    const auto indices = feature.innerIndexPtr();
+    const auto values = feature.valuePtr();
+    const auto nnz = feature.nonZeros();
+    auto confidence = 0.0;
+    for (auto i = decltype(nnz)(0); i < nnz; ++i) {
+      confidence += covariances[indices[i]] * values[i] * values[i];
+    }
+    return confidence;
+  }
+
+  // With v = σ ∘ x : μ += mean_step * v, σ -= covariance_step * v ∘ v, in one pass.
+  template <typename DerivedT, typename VectorT>
+  void update_means_and_covariances(const Eigen::MatrixBase<DerivedT>& feature,
+                                    VectorT& means,
+                                    VectorT& covariances,
+                                    const double mean_step,
+                                    const double covariance_step) {
+    using Scalar = typename VectorT::Scalar;
+    // v is evaluated once per block into a stack buffer, before σ of the block is written.
+    using Block = Eigen::Matrix<Scalar, Eigen::Dynamic, 1, Eigen::ColMajor, kFusedBlock, 1>;
+    const auto& x = feature.derived();
+    for (Eigen::Index i = 0; i < x.size(); i += kFusedBlock) {
+      const auto size = std::min(kFusedBlock, x.size() - i);
+      const Block v = covariances.segment(i, size).cwiseProduct(x.segment(i, size).template cast<Scalar>());
+      means.segment(i, size) += Scalar(mean_step) * v;
+      covariances.segment(i, size) -= Scalar(covariance_step) * v.cwiseAbs2();
+    }
+  }
+
+  template <typename ScalarT, int OptionsT, typename IndexT, typename VectorT>
+  void update_means_and_covariances(const Eigen::SparseVector<ScalarT, OptionsT, IndexT>& feature,
+                                    VectorT& means,
+                                    VectorT& covariances,
+                                    const double mean_step,
+                                    const double covariance_step) {
+    const auto indices = feature.innerIndexPtr();
+    const auto values = feature.valuePtr();
+    const auto nnz = feature.nonZeros();
+    for (auto i = decltype(nnz)(0); i < nnz; ++i) {
+      const auto index = indices[i];
+      const auto v = covariances[index] * values[i];
+      means[index] += mean_step * v;
+      covariances[index] -= covariance_step * v * v;
+    }
+  }
+};
+
+#endif //MOCHIMOCHI_FUNCTIONS_FUSED_HPP_
@@ -0,0 +1,181 @@
+#ifndef MOCHIMOCHI_FUNCTIONS_QUANTIZED_HPP_
+#define MOCHIMOCHI_FUNCTIONS_QUANTIZED_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#if defined(__AVX2__) || defined(__F16C__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Kernels of the quantized (inference-only) models. The AVX2 and F16C paths are taken when
+// the header is compiled for them (e.g. -march=native), SSE2 (any x86-64) otherwise; the
+// portable loops give the same results.
+namespace functions {
+  // IEEE 754 binary16 <-> binary32, round to nearest even. Only the conversion of a whole
+  // model (export) uses the software path when F16C is available.
+  inline std::uint16_t float_to_half(const float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const std::uint32_t sign = (bits >> 16) & 0x8000u;
+    const std::uint32_t magnitude = bits & 0x7fffffffu;
+
+    if (magnitude >= 0x7f800000u) {
+      // inf stays inf, NaN stays a quiet NaN
+      return static_cast<std::uint16_t>(sign | 0x7c00u | (magnitude > 0x7f800000u ? 0x200u : 0u));
+    }
+    if (magnitude >= 0x477ff000u) {
+      // rounds to a value above the largest half
+      return static_cast<std::uint16_t>(sign | 0x7c00u);
+    }
+    if (magnitude < 0x38800000u) {
+      // subnormal half (or zero): shift the mantissa with its implicit bit into place
+      if (magnitude < 0x33000000u) { return static_cast<std::uint16_t>(sign); }
+      const std::uint32_t exponent = magnitude >> 23;
+      const std::uint32_t mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+      const std::uint32_t shift = 126 - exponent;
+      std::uint32_t half = mantissa >> shift;
+      const std::uint32_t rest = mantissa & ((1u << shift) - 1);
+      const std::uint32_t halfway = 1u << (shift - 1);
+      if (rest > halfway || (rest == halfway && (half & 1u))) { ++half; }
+      return static_cast<std::uint16_t>(sign | half);
+    }
+
+    std::uint32_t half = ((magnitude - 0x38000000u) >> 13);
+    const std::uint32_t rest = magnitude & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) { ++half; }
+    return static_cast<std::uint16_t>(sign | half);
+  }
+
+  inline float half_to_float(const std::uint16_t value) {
+#if defined(__F16C__)
+    return _cvtsh_ss(value);
+#else
+    const std::uint32_t sign = static_cast<std::uint32_t>(value & 0x8000u) << 16;
+    std::uint32_t exponent = (value >> 10) & 0x1fu;
+    std::uint32_t mantissa = value & 0x3ffu;
+    std::uint32_t bits;
+    if (exponent == 0x1fu) {
+      bits = sign | 0x7f800000u | (mantissa << 13);
+    } else if (exponent != 0) {
+      bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+      bits = sign;
+    } else {
+      // normalize a subnormal half
+      exponent = 113;
+      while ((mantissa & 0x400u) == 0) {
+        mantissa <<= 1;
+        --exponent;
+      }
+      bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+#endif
+  }
+
+  // max |x_i|
+  inline double max_abs(const double* x, const std::size_t n) {
+    auto result = 0.0;
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    const auto sign = _mm256_set1_pd(-0.0);
+    auto max = _mm256_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+      max = _mm256_max_pd(max, _mm256_andnot_pd(sign, _mm256_loadu_pd(x + i)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, max);
+    result = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#elif defined(__SSE2__)
+    const auto sign = _mm_set1_pd(-0.0);
+    auto max = _mm_setzero_pd();
+    for (; i + 2 <= n; i += 2) {
+      max = _mm_max_pd(max, _mm_andnot_pd(sign, _mm_loadu_pd(x + i)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, max);
+    result = std::max(lanes[0], lanes[1]);
+#endif
+    for (; i < n; ++i) {
+      result = std::max(result, std::abs(x[i]));
+    }
+    return result;
+  }
+
+  // Σ w_i x_i of int8 weights and a double feature, accumulated in double. The weights are
+  // widened in registers, so the feature is read once and is not quantized.
+  inline double dot_int8(const std::int8_t* w, const double* x, const std::size_t n) {
+    auto result = 0.0;
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    auto low_sum = _mm256_setzero_pd();
+    auto high_sum = _mm256_setzero_pd();
+    for (; i + 8 <= n; i += 8) {
+      const auto ints = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(w + i)));
+      const auto low = _mm256_cvtepi32_pd(_mm256_castsi256_si128(ints));
+      const auto high = _mm256_cvtepi32_pd(_mm256_extracti128_si256(ints, 1));
+#if defined(__FMA__)
+      low_sum = _mm256_fmadd_pd(low, _mm256_loadu_pd(x + i), low_sum);
+      high_sum = _mm256_fmadd_pd(high, _mm256_loadu_pd(x + i + 4), high_sum);
+#else
+      low_sum = _mm256_add_pd(low_sum, _mm256_mul_pd(low, _mm256_loadu_pd(x + i)));
+      high_sum = _mm256_add_pd(high_sum, _mm256_mul_pd(high, _mm256_loadu_pd(x + i + 4)));
+#endif
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(low_sum, high_sum));
+    result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(__SSE2__)
+    auto sum0 = _mm_setzero_pd();
+    auto sum1 = _mm_setzero_pd();
+    for (; i + 8 <= n; i += 8) {
+      // sign extension by unpacking each value with itself and shifting it back down
+      const auto bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(w + i));
+      const auto words = _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+      const auto low = _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16);
+      const auto high = _mm_srai_epi32(_mm_unpackhi_epi16(words, words), 16);
+      sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_cvtepi32_pd(low), _mm_loadu_pd(x + i)));
+      sum1 = _mm_add_pd(sum1, _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(low, low)), _mm_loadu_pd(x + i + 2)));
+      sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_cvtepi32_pd(high), _mm_loadu_pd(x + i + 4)));
+      sum1 = _mm_add_pd(sum1, _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(high, high)), _mm_loadu_pd(x + i + 6)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+    result = lanes[0] + lanes[1];
+#endif
+    for (; i < n; ++i) {
+      result += w[i] * x[i];
+    }
+    return result;
+  }
+
+  // Σ half_i x_i, accumulated in double.
+  inline double dot_half(const std::uint16_t* h, const double* x, const std::size_t n) {
+    auto result = 0.0;
+    std::size_t i = 0;
+#if defined(__AVX2__) && defined(__F16C__)
+    auto sum = _mm256_setzero_pd();
+    for (; i + 8 <= n; i += 8) {
+      const auto values = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i)));
+      sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(values)), _mm256_loadu_pd(x + i)));
+      sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(values, 1)), _mm256_loadu_pd(x + i + 4)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, sum);
+    result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+    for (; i < n; ++i) {
+      result += half_to_float(h[i]) * x[i];
+    }
+    return result;
+  }
+};
+
+#endif //MOCHIMOCHI_FUNCTIONS_QUANTIZED_HPP_
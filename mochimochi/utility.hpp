@@ -2,5 +2,14 @@
 #define MOCHIMOCHI_UTILITY_HPP_
 
 #include "./utility/load_svmlight_file.hpp"
+#include "./utility/parse_svmlight.hpp"
+#include "./utility/feature_hasher.hpp"
+#include "./utility/mapped_file.hpp"
+#include "./utility/svmlight_reader.hpp"
+#include "./utility/parallel_svmlight_reader.hpp"
+#include "./utility/csr_cache.hpp"
+#include "./utility/fd_line_reader.hpp"
+#include "./utility/spsc_ring.hpp"
+#include "./utility/thread_pool.hpp"
 
 #endif //MOCHIMOCHI_UTILITY_HPP_
@@ -0,0 +1,233 @@
+#ifndef MOCHIMOCHI_CSR_CACHE_HPP_
+#define MOCHIMOCHI_CSR_CACHE_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include "./mapped_file.hpp"
+#include "./parse_svmlight.hpp"
+#include "./svmlight_reader.hpp"
+
+namespace utility {
+  /**
+   * Layout of a CSR cache file. Every section starts on an 8 byte boundary.
+   *
+   *   CsrHeader
+   *   double        labels[rows]
+   *   std::uint64_t offsets[rows + 1]
+   *   std::uint32_t indices[nnz]      (0-based)
+   *   ValueT        values[nnz]
+   */
+  struct CsrHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t value_size;
+    std::uint64_t dim;
+    std::uint64_t rows;
+    std::uint64_t nnz;
+  };
+
+  namespace detail {
+    constexpr char kCsrMagic[8] = {'M', 'O', 'C', 'H', 'I', 'C', 'S', 'R'};
+    constexpr std::uint32_t kCsrVersion = 1;
+
+    inline std::size_t align8(const std::size_t offset) {
+      return (offset + 7) & ~std::size_t(7);
+    }
+
+    struct CsrSections {
+      std::size_t labels;
+      std::size_t offsets;
+      std::size_t indices;
+      std::size_t values;
+      std::size_t size;
+    };
+
+    inline CsrSections csr_sections(const CsrHeader& header) {
+      CsrSections sections;
+      sections.labels = align8(sizeof(CsrHeader));
+      sections.offsets = align8(sections.labels + header.rows * sizeof(double));
+      sections.indices = align8(sections.offsets + (header.rows + 1) * sizeof(std::uint64_t));
+      sections.values = align8(sections.indices + header.nnz * sizeof(std::uint32_t));
+      sections.size = sections.values + header.nnz * header.value_size;
+      return sections;
+    }
+  }
+
+  /**
+   * Convert a svmlight file into a CSR cache file once, so later epochs can skip text parsing.
+   * The file is sized in a first counting pass and then filled in place through a writable
+   * mapping. Returns the number of rows written.
+   */
+  template<typename ValueT = double>
+  inline std::size_t write_csr_cache(const std::string& svmlight_path,
+                                     const std::string& cache_path,
+                                     const std::size_t dim) {
+    if (dim > std::numeric_limits<std::uint32_t>::max()) { throw std::runtime_error("CSR cache indices are limited to 32 bits."); }
+    SvmlightReader<double> reader(svmlight_path, dim);
+
+    CsrHeader header;
+    std::copy(detail::kCsrMagic, detail::kCsrMagic + 8, header.magic);
+    header.version = detail::kCsrVersion;
+    header.value_size = sizeof(ValueT);
+    header.dim = dim;
+    header.rows = 0;
+    header.nnz = 0;
+    for (const auto& example : reader) {
+      ++header.rows;
+      header.nnz += example.feature.nonZeros();
+    }
+
+    const auto sections = detail::csr_sections(header);
+    const auto fd = ::open(cache_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) { throw std::runtime_error("Cannot create file: " + cache_path); }
+    if (::ftruncate(fd, sections.size) < 0) {
+      ::close(fd);
+      throw std::runtime_error("Cannot resize file: " + cache_path);
+    }
+    const auto address = ::mmap(nullptr, sections.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) { throw std::runtime_error("Cannot map file: " + cache_path); }
+
+    const auto base = static_cast<char*>(address);
+    std::memcpy(base, &header, sizeof(header));
+    const auto labels = reinterpret_cast<double*>(base + sections.labels);
+    const auto offsets = reinterpret_cast<std::uint64_t*>(base + sections.offsets);
+    const auto indices = reinterpret_cast<std::uint32_t*>(base + sections.indices);
+    const auto values = reinterpret_cast<ValueT*>(base + sections.values);
+
+    std::size_t row = 0;
+    std::uint64_t offset = 0;
+    offsets[0] = 0;
+    reader.rewind();
+    for (const auto& example : reader) {
+      const auto nnz = static_cast<std::size_t>(example.feature.nonZeros());
+      // The mapping is sized by the first pass; a file that changed since must not overrun it.
+      if (row == header.rows || offset + nnz > header.nnz) {
+        ::munmap(address, sections.size);
+        throw std::runtime_error("File changed while writing the CSR cache: " + svmlight_path);
+      }
+      labels[row] = example.label;
+      std::copy(example.feature.innerIndexPtr(), example.feature.innerIndexPtr() + nnz, indices + offset);
+      std::copy(example.feature.valuePtr(), example.feature.valuePtr() + nnz, values + offset);
+      offset += nnz;
+      offsets[++row] = offset;
+    }
+
+    ::munmap(address, sections.size);
+    if (row != header.rows || offset != header.nnz) {
+      throw std::runtime_error("File changed while writing the CSR cache: " + svmlight_path);
+    }
+    return row;
+  }
+
+  /**
+   * Read-only view of a CSR cache file. The file is memory mapped and the arrays are used
+   * in place, so rows are never parsed again; loading only checks the offsets and indices
+   * once, in O(rows + nnz).
+   *
+   * The reader interface matches SvmlightReader: rows are copied into a reused Example
+   * buffer, which costs O(nnz) and no allocation once the buffer has grown.
+   */
+  template<typename T, typename ValueT = double>
+  class CsrDataset {
+  private :
+    MappedFile _file;
+    CsrHeader _header;
+    const double* _labels;
+    const std::uint64_t* _offsets;
+    const std::uint32_t* _indices;
+    const ValueT* _values;
+    std::size_t _cursor;
+    Example<T> _example;
+
+  public :
+    explicit CsrDataset(const std::string& cache_path)
+      : _file(cache_path),
+        _cursor(0) {
+      if (_file.size() < sizeof(CsrHeader)) { throw std::runtime_error("Not a CSR cache file: " + cache_path); }
+      std::memcpy(&_header, _file.begin(), sizeof(CsrHeader));
+      if (!std::equal(detail::kCsrMagic, detail::kCsrMagic + 8, _header.magic)) {
+        throw std::runtime_error("Not a CSR cache file: " + cache_path);
+      }
+      if (_header.version != detail::kCsrVersion) { throw std::runtime_error("Unsupported CSR cache version: " + cache_path); }
+      if (_header.value_size != sizeof(ValueT)) { throw std::runtime_error("CSR cache value type mismatch: " + cache_path); }
+
+      // Bound the counts by the file size first, so that the section sizes cannot overflow.
+      if (_header.rows >= _file.size() / sizeof(double) || _header.nnz > _file.size() / sizeof(std::uint32_t)) {
+        throw std::runtime_error("Truncated CSR cache file: " + cache_path);
+      }
+      const auto sections = detail::csr_sections(_header);
+      if (_file.size() < sections.size) { throw std::runtime_error("Truncated CSR cache file: " + cache_path); }
+      _labels = reinterpret_cast<const double*>(_file.begin() + sections.labels);
+      _offsets = reinterpret_cast<const std::uint64_t*>(_file.begin() + sections.offsets);
+      _indices = reinterpret_cast<const std::uint32_t*>(_file.begin() + sections.indices);
+      _values = reinterpret_cast<const ValueT*>(_file.begin() + sections.values);
+      validate(cache_path);
+    }
+
+    virtual ~CsrDataset() { }
+
+  private :
+    // load() and the batch predictions use the offsets and indices unchecked, so a corrupt
+    // cache is rejected here, in one O(rows + nnz) pass over the arrays.
+    void validate(const std::string& cache_path) const {
+      if (_offsets[0] != 0 || _offsets[_header.rows] != _header.nnz) {
+        throw std::runtime_error("Corrupt CSR cache offsets: " + cache_path);
+      }
+      for (std::size_t row = 0; row < _header.rows; ++row) {
+        if (_offsets[row] > _offsets[row + 1]) { throw std::runtime_error("Corrupt CSR cache offsets: " + cache_path); }
+      }
+      for (std::size_t i = 0; i < _header.nnz; ++i) {
+        if (_indices[i] >= _header.dim) { throw std::runtime_error("Corrupt CSR cache indices: " + cache_path); }
+      }
+    }
+
+  public :
+    using value_type = Example<T>;
+    using iterator = ExampleIterator<CsrDataset>;
+
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(); }
+
+    std::size_t rows() const { return _header.rows; }
+    std::size_t dim() const { return _header.dim; }
+    std::size_t nnz() const { return _header.nnz; }
+
+    T label(const std::size_t row) const { return static_cast<T>(_labels[row]); }
+    const std::uint64_t* offsets() const { return _offsets; }
+    const std::uint32_t* indices() const { return _indices; }
+    const ValueT* values() const { return _values; }
+
+    /**
+     * Copy row `row` into `example`.
+     */
+    void load(const std::size_t row, Example<T>& example) const {
+      const auto first = _offsets[row];
+      const auto nnz = static_cast<std::size_t>(_offsets[row + 1] - first);
+      example.label = label(row);
+      example.feature.resize(_header.dim);
+      example.feature.resizeNonZeros(nnz);
+      std::copy(_indices + first, _indices + first + nnz, example.feature.innerIndexPtr());
+      std::copy(_values + first, _values + first + nnz, example.feature.valuePtr());
+    }
+
+    const Example<T>* next() {
+      if (_cursor >= _header.rows) { return nullptr; }
+      load(_cursor++, _example);
+      return &_example;
+    }
+
+    void rewind() {
+      _cursor = 0;
+    }
+  };
+}
+
+#endif //MOCHIMOCHI_CSR_CACHE_HPP_
@@ -0,0 +1,291 @@
+#ifndef MOCHIMOCHI_DECOMPRESSING_READER_HPP_
+#define MOCHIMOCHI_DECOMPRESSING_READER_HPP_
+
+/**
+ * Streaming readers for compressed svmlight files. gzip (and plain text) is read through
+ * zlib, so users of this header link with -lz. zstd frames are decoded when the header is
+ * compiled with MOCHIMOCHI_WITH_ZSTD and linked with -lzstd (-DENABLE_ZSTD=ON in the
+ * pipeline example); otherwise a zstd file throws.
+ *
+ * This header is not part of utility.hpp so that the other readers keep no zlib dependency.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef MOCHIMOCHI_WITH_ZSTD
+#include <zstd.h>
+#endif
+#include "./fd_line_reader.hpp"
+#include "./feature_hasher.hpp"
+#include "./parse_svmlight.hpp"
+#include "./svmlight_reader.hpp"
+
+namespace utility {
+  /**
+   * Decompresses a file on its own thread into a pipe, so decompression overlaps with
+   * whatever consumes the read end: an FdLineReader, a BinaryOMLPipeline, ...
+   *
+   * The format is taken from the magic bytes: zstd frames, gzip members (concatenated
+   * members included) or, failing both, plain text passed through unchanged. The pipe gives
+   * back-pressure for free: the thread blocks while the consumer is behind.
+   *
+   * Errors of the decompression thread (a corrupt or truncated file) end the stream early
+   * and are rethrown by finish().
+   */
+  class DecompressingPipe {
+  private :
+    static constexpr std::size_t kBufferSize = 1 << 17;
+
+  private :
+    int _read_fd;
+    std::thread _worker;
+    std::exception_ptr _error;
+
+  public :
+    explicit DecompressingPipe(const std::string& path)
+      : _read_fd(-1) {
+      const auto in = ::open(path.c_str(), O_RDONLY);
+      if (in < 0) { throw std::runtime_error("Cannot open file: " + path); }
+
+      int fds[2];
+      if (::pipe(fds) < 0) {
+        ::close(in);
+        throw std::runtime_error("Cannot create pipe: " + path);
+      }
+#ifdef F_SETPIPE_SZ
+      // A larger pipe lets the thread run further ahead; the kernel default still works.
+      ::fcntl(fds[1], F_SETPIPE_SZ, 1 << 20);
+#endif
+      _read_fd = fds[0];
+
+      const auto out = fds[1];
+      _worker = std::thread([this, in, out, path] {
+          block_sigpipe();
+          try {
+            decompress(in, out, path);
+          } catch (...) {
+            _error = std::current_exception();
+          }
+          ::close(out);
+        });
+    }
+
+    DecompressingPipe(const DecompressingPipe&) = delete;
+    DecompressingPipe& operator=(const DecompressingPipe&) = delete;
+
+    virtual ~DecompressingPipe() {
+      // Closing the read end first unblocks a thread still writing into a full pipe.
+      if (_read_fd >= 0) { ::close(_read_fd); }
+      if (_worker.joinable()) { _worker.join(); }
+    }
+
+  private :
+    static void block_sigpipe() {
+      // A consumer that stops early closes the read end; the write then fails with EPIPE
+      // instead of killing the process.
+      sigset_t set;
+      sigemptyset(&set);
+      sigaddset(&set, SIGPIPE);
+      pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    }
+
+    // Returns false when the consumer has gone away.
+    static bool write_all(const int fd, const char* data, std::size_t size) {
+      while (size > 0) {
+        const auto n = ::write(fd, data, size);
+        if (n < 0) {
+          if (errno == EINTR) { continue; }
+          if (errno == EPIPE) { return false; }
+          throw std::runtime_error(std::string("Cannot write pipe: ") + std::strerror(errno));
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+      }
+      return true;
+    }
+
+    static bool is_zstd(const int fd) {
+      unsigned char magic[4];
+      if (::pread(fd, magic, sizeof(magic), 0) != static_cast<ssize_t>(sizeof(magic))) { return false; }
+      return magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd;
+    }
+
+    static void decompress(const int in, const int out, const std::string& path) {
+      if (is_zstd(in)) {
+#ifdef MOCHIMOCHI_WITH_ZSTD
+        try {
+          decompress_zstd(in, out, path);
+        } catch (...) {
+          ::close(in);
+          throw;
+        }
+        ::close(in);
+        return;
+#else
+        ::close(in);
+        throw std::runtime_error("zstd input needs MOCHIMOCHI_WITH_ZSTD (-DENABLE_ZSTD=ON): " + path);
+#endif
+      }
+      decompress_gzip(in, out, path);
+    }
+
+    // zlib reads plain files transparently, so this also covers uncompressed input.
+    static void decompress_gzip(const int in, const int out, const std::string& path) {
+      const auto file = ::gzdopen(in, "rb");
+      if (file == nullptr) {
+        ::close(in);
+        throw std::runtime_error("Cannot open file: " + path);
+      }
+      ::gzbuffer(file, kBufferSize);
+
+      std::vector<char> buffer(kBufferSize);
+      while (true) {
+        const auto n = ::gzread(file, buffer.data(), static_cast<unsigned>(buffer.size()));
+        if (n < 0) {
+          int code;
+          const std::string message = ::gzerror(file, &code);
+          ::gzclose(file);
+          throw std::runtime_error("Cannot decompress " + path + ": " + message);
+        }
+        if (n == 0) { break; }
+        if (!write_all(out, buffer.data(), static_cast<std::size_t>(n))) { break; }
+      }
+      if (::gzclose(file) != Z_OK) { throw std::runtime_error("Truncated gzip file: " + path); }
+    }
+
+#ifdef MOCHIMOCHI_WITH_ZSTD
+    static void decompress_zstd(const int in, const int out, const std::string& path) {
+      std::unique_ptr<ZSTD_DCtx, std::size_t (*)(ZSTD_DCtx*)> context(ZSTD_createDCtx(), ZSTD_freeDCtx);
+      if (!context) { throw std::runtime_error("Cannot create zstd context: " + path); }
+
+      std::vector<char> input_buffer(ZSTD_DStreamInSize());
+      std::vector<char> output_buffer(ZSTD_DStreamOutSize());
+      std::size_t remaining = 0;
+      while (true) {
+        const auto n = ::read(in, input_buffer.data(), input_buffer.size());
+        if (n < 0) {
+          if (errno == EINTR) { continue; }
+          throw std::runtime_error("Cannot read file: " + path);
+        }
+        if (n == 0) { break; }
+
+        ZSTD_inBuffer input = { input_buffer.data(), static_cast<std::size_t>(n), 0 };
+        while (input.pos < input.size) {
+          ZSTD_outBuffer output = { output_buffer.data(), output_buffer.size(), 0 };
+          remaining = ZSTD_decompressStream(context.get(), &output, &input);
+          if (ZSTD_isError(remaining)) {
+            throw std::runtime_error("Cannot decompress " + path + ": " + ZSTD_getErrorName(remaining));
+          }
+          if (!write_all(out, output_buffer.data(), output.pos)) { return; }
+        }
+      }
+      if (remaining != 0) { throw std::runtime_error("Truncated zstd file: " + path); }
+    }
+#endif
+
+  public :
+    /**
+     * Read end of the pipe, owned by this object.
+     */
+    int fd() const {
+      return _read_fd;
+    }
+
+    /**
+     * Wait for the decompression thread and rethrow its error, if any. Call it once the
+     * read end reached end of file.
+     */
+    void finish() {
+      if (_worker.joinable()) { _worker.join(); }
+      if (_error) { std::rethrow_exception(_error); }
+    }
+  };
+
+  /**
+   * SvmlightReader over a gzip/zstd compressed (or plain) file. Decompression runs on a
+   * separate thread while the caller parses and updates:
+   *
+   *   for(const auto& example : utility::CompressedSvmlightReader<int>("train.svmdata.gz", dim)) {
+   *     arow.update(example.feature, example.label);
+   *   }
+   *
+   * As with SvmlightReader, a reference to an example is valid until the iterator is
+   * incremented, and rewind() starts decompressing again from the beginning of the file.
+   */
+  template<typename T>
+  class CompressedSvmlightReader {
+  private :
+    const std::string kPath;
+    const std::size_t kDim;
+
+  private :
+    std::unique_ptr<const FeatureHasher> _hasher;
+    std::unique_ptr<DecompressingPipe> _pipe;
+    std::unique_ptr<FdLineReader> _lines;
+    Example<T> _example;
+
+  public :
+    CompressedSvmlightReader(const std::string& path, const std::size_t dim)
+      : kPath(path),
+        kDim(dim) {
+      assert(dim > 0);
+      rewind();
+    }
+
+    CompressedSvmlightReader(const std::string& path, const FeatureHasher& hasher)
+      : kPath(path),
+        kDim(hasher.dim()),
+        _hasher(new FeatureHasher(hasher)) {
+      rewind();
+    }
+
+    virtual ~CompressedSvmlightReader() { }
+
+  public :
+    using value_type = Example<T>;
+    using iterator = ExampleIterator<CompressedSvmlightReader>;
+
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(); }
+
+    /**
+     * Parse the next example into `example`. Returns false at the end of the file and
+     * throws if the file could not be decompressed.
+     */
+    bool next(Example<T>& example) {
+      std::pair<const char*, const char*> line;
+      while (_lines->next(line)) {
+        const auto parsed = _hasher ? parse_svmlight_line(line.first, line.second, *_hasher, example)
+                                    : parse_svmlight_line(line.first, line.second, kDim, example);
+        if (parsed) { return true; }
+      }
+      _pipe->finish();
+      return false;
+    }
+
+    const Example<T>* next() {
+      return next(_example) ? &_example : nullptr;
+    }
+
+    void rewind() {
+      _lines.reset();
+      _pipe.reset();
+      _pipe.reset(new DecompressingPipe(kPath));
+      _lines.reset(new FdLineReader(_pipe->fd()));
+    }
+  };
+}
+
+#endif //MOCHIMOCHI_DECOMPRESSING_READER_HPP_
@@ -0,0 +1,78 @@
+#ifndef MOCHIMOCHI_FD_LINE_READER_HPP_
+#define MOCHIMOCHI_FD_LINE_READER_HPP_
+
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace utility {
+  /**
+   * Splits the bytes read from a file descriptor (a pipe, stdin, a socket...) into lines.
+   * The buffer is allocated once and only grows for a line longer than itself.
+   */
+  class FdLineReader {
+  private :
+    const int kFd;
+
+  private :
+    std::vector<char> _buffer;
+    std::size_t _begin;
+    std::size_t _end;
+    bool _eof;
+
+  public :
+    explicit FdLineReader(const int fd, const std::size_t buffer_size = 1 << 20)
+      : kFd(fd),
+        _buffer(buffer_size),
+        _begin(0),
+        _end(0),
+        _eof(false) {
+    }
+
+    virtual ~FdLineReader() { }
+
+  public :
+    /**
+     * Returns the next line as [first, last) without its newline. The range stays valid
+     * until the next call. Returns false at end of input.
+     */
+    bool next(std::pair<const char*, const char*>& line) {
+      while (true) {
+        const auto data = _buffer.data();
+        const auto newline = static_cast<const char*>(std::memchr(data + _begin, '\n', _end - _begin));
+        if (newline != nullptr) {
+          line = std::make_pair(data + _begin, newline);
+          _begin = static_cast<std::size_t>(newline - data) + 1;
+          return true;
+        }
+        if (_eof) {
+          if (_begin == _end) { return false; }
+          line = std::make_pair(data + _begin, data + _end);
+          _begin = _end;
+          return true;
+        }
+
+        std::memmove(data, data + _begin, _end - _begin);
+        _end -= _begin;
+        _begin = 0;
+        if (_end == _buffer.size()) { _buffer.resize(_buffer.size() * 2); }
+
+        const auto n = ::read(kFd, _buffer.data() + _end, _buffer.size() - _end);
+        if (n < 0) {
+          if (errno == EINTR) { continue; }
+          throw std::runtime_error(std::string("Cannot read input: ") + std::strerror(errno));
+        }
+        if (n == 0) {
+          _eof = true;
+        } else {
+          _end += static_cast<std::size_t>(n);
+        }
+      }
+    }
+  };
+}
+
+#endif //MOCHIMOCHI_FD_LINE_READER_HPP_
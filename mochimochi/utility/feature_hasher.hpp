@@ -0,0 +1,184 @@
+#ifndef MOCHIMOCHI_FEATURE_HASHER_HPP_
+#define MOCHIMOCHI_FEATURE_HASHER_HPP_
+
+#include <Eigen/Sparse>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include "./parse_svmlight.hpp"
+
+namespace utility {
+  /**
+   * Hashing trick: maps feature names of any kind ("3148", "word=mochi", ...) into a table of
+   * 2^bits coordinates with MurmurHash3, so the model dimension stays fixed whatever the raw
+   * feature ids are. With `signed_hash` the hash also picks the sign of the value, which keeps
+   * colliding features from biasing the inner product.
+   */
+  class FeatureHasher {
+  private :
+    const std::size_t kBits;
+    const bool kSigned;
+    const std::uint32_t kSeed;
+
+  public :
+    FeatureHasher(const std::size_t bits, const bool signed_hash = false, const std::uint32_t seed = 0)
+      : kBits(bits),
+        kSigned(signed_hash),
+        kSeed(seed) {
+      assert(bits > 0);
+      assert(bits <= 31);
+    }
+
+    virtual ~FeatureHasher() { }
+
+  private :
+    static std::uint32_t rotl(const std::uint32_t x, const int r) {
+      return (x << r) | (x >> (32 - r));
+    }
+
+    // MurmurHash3_x86_32
+    std::uint32_t murmur3(const char* data, const std::size_t length) const {
+      constexpr std::uint32_t c1 = 0xcc9e2d51;
+      constexpr std::uint32_t c2 = 0x1b873593;
+
+      auto h = kSeed;
+      const auto n_blocks = length / 4;
+      for (std::size_t i = 0; i < n_blocks; ++i) {
+        std::uint32_t k;
+        std::memcpy(&k, data + i * 4, sizeof(k));
+        k *= c1;
+        k = rotl(k, 15);
+        k *= c2;
+        h ^= k;
+        h = rotl(h, 13);
+        h = h * 5 + 0xe6546b64;
+      }
+
+      const auto tail = reinterpret_cast<const std::uint8_t*>(data + n_blocks * 4);
+      std::uint32_t k = 0;
+      switch (length & 3) {
+      case 3 : k ^= std::uint32_t(tail[2]) << 16;
+        // falls through
+      case 2 : k ^= std::uint32_t(tail[1]) << 8;
+        // falls through
+      case 1 : k ^= tail[0];
+        k *= c1;
+        k = rotl(k, 15);
+        k *= c2;
+        h ^= k;
+      }
+
+      h ^= static_cast<std::uint32_t>(length);
+      h ^= h >> 16;
+      h *= 0x85ebca6b;
+      h ^= h >> 13;
+      h *= 0xc2b2ae35;
+      h ^= h >> 16;
+      return h;
+    }
+
+  public :
+    std::size_t dim() const {
+      return std::size_t(1) << kBits;
+    }
+
+    /**
+     * Hash the feature name [first, last) to its 0-based coordinate and its sign (+1/-1).
+     */
+    std::pair<std::size_t, double> hash(const char* first, const char* last) const {
+      const auto h = murmur3(first, static_cast<std::size_t>(last - first));
+      const auto index = static_cast<std::size_t>(h & (dim() - 1));
+      const auto sign = (kSigned && (h >> 31)) ? -1.0 : 1.0;
+      return std::make_pair(index, sign);
+    }
+
+    std::pair<std::size_t, double> hash(const std::string& name) const {
+      return hash(name.data(), name.data() + name.size());
+    }
+  };
+
+  /**
+   * Parse one svmlight-like line "<label> <name>[:<value>] ..." through the hashing trick.
+   * Names may be any non-blank text; a name without ":<value>" counts as 1, and svmlight's
+   * "qid:<n>" is skipped. Features hashing to the same coordinate are summed. The feature is
+   * refilled in place like the dim overload.
+   *
+   * Hashed coordinates come in random order, so they are collected into a per-thread buffer,
+   * sorted and merged, and appended with insertBack: O(nnz log nnz) per line instead of the
+   * O(nnz) shift of every out of order coeffRef, and no allocation once the buffer has grown.
+   */
+  template<typename T>
+  inline bool parse_svmlight_line(const char* first,
+                                  const char* last,
+                                  const FeatureHasher& hasher,
+                                  T& label,
+                                  Eigen::SparseVector<double>& feature) {
+    auto p = detail::skip_blanks(first, last);
+    if (p == last || *p == '#') { return false; }
+
+    if (!detail::parse_label(p, last, label)) { return false; }
+
+    thread_local std::vector<std::pair<std::size_t, double>> hashed;
+    hashed.clear();
+    while (true) {
+      p = detail::skip_blanks(p, last);
+      if (p == last || *p == '#') { break; }
+
+      const auto name_first = p;
+      while (p != last && *p != ':' && !detail::is_blank(*p)) { ++p; }
+      const auto name_last = p;
+
+      auto value = 1.0;
+      if (p != last && *p == ':') {
+        if (name_last - name_first == 3 && std::equal(name_first, name_last, "qid")) {
+          p = detail::skip_token(p, last);
+          continue;
+        }
+        ++p;
+        if (!detail::parse_double(p, last, value) || (p != last && !detail::is_blank(*p))) {
+          p = detail::skip_token(p, last);
+          continue;
+        }
+      }
+
+      const auto coordinate = hasher.hash(name_first, name_last);
+      hashed.emplace_back(coordinate.first, coordinate.second * value);
+    }
+
+    std::sort(hashed.begin(), hashed.end(),
+              [](const std::pair<std::size_t, double>& a, const std::pair<std::size_t, double>& b) {
+                return a.first < b.first;
+              });
+    feature.resize(hasher.dim());
+    feature.reserve(hashed.size());
+    for (std::size_t i = 0; i < hashed.size(); ) {
+      const auto index = hashed[i].first;
+      auto value = 0.0;
+      for (; i < hashed.size() && hashed[i].first == index; ++i) { value += hashed[i].second; }
+      feature.insertBack(index) = value;
+    }
+    return true;
+  }
+
+  template<typename T>
+  inline bool parse_svmlight_line(const std::string& line,
+                                  const FeatureHasher& hasher,
+                                  T& label,
+                                  Eigen::SparseVector<double>& feature) {
+    return parse_svmlight_line(line.data(), line.data() + line.size(), hasher, label, feature);
+  }
+
+  template<typename T>
+  inline bool parse_svmlight_line(const char* first,
+                                  const char* last,
+                                  const FeatureHasher& hasher,
+                                  Example<T>& example) {
+    return parse_svmlight_line(first, last, hasher, example.label, example.feature);
+  }
+}
+
+#endif //MOCHIMOCHI_FEATURE_HASHER_HPP_
@@ -22,6 +22,7 @@ namespace utility {
       int number;
       double value;
       iss >> number >> value;
+      if (number < 1 || static_cast<std::size_t>(number) > dim) { continue; }
       values(number - 1) = value;
     }
     return std::make_pair(label, values);
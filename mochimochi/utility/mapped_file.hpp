@@ -0,0 +1,69 @@
+#ifndef MOCHIMOCHI_MAPPED_FILE_HPP_
+#define MOCHIMOCHI_MAPPED_FILE_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <string>
+
+namespace utility {
+  /**
+   * Read-only memory mapping of a whole file. The pages are loaded lazily by the kernel,
+   * so opening a multi-GB file costs nothing until it is read.
+   */
+  class MappedFile {
+  private :
+    const char* _data;
+    std::size_t _size;
+
+  public :
+    explicit MappedFile(const std::string& path)
+      : _data(nullptr),
+        _size(0) {
+      const auto fd = ::open(path.c_str(), O_RDONLY);
+      if (fd < 0) { throw std::runtime_error("Cannot open file: " + path); }
+
+      struct stat status;
+      if (::fstat(fd, &status) < 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat file: " + path);
+      }
+      _size = static_cast<std::size_t>(status.st_size);
+
+      if (_size > 0) {
+        const auto address = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+          ::close(fd);
+          throw std::runtime_error("Cannot map file: " + path);
+        }
+        ::madvise(address, _size, MADV_SEQUENTIAL);
+        _data = static_cast<const char*>(address);
+      }
+      ::close(fd);
+    }
+
+    MappedFile(MappedFile&& other) noexcept
+      : _data(other._data),
+        _size(other._size) {
+      other._data = nullptr;
+      other._size = 0;
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+
+    virtual ~MappedFile() {
+      if (_data != nullptr) { ::munmap(const_cast<char*>(_data), _size); }
+    }
+
+  public :
+    const char* begin() const { return _data; }
+    const char* end() const { return _data + _size; }
+    std::size_t size() const { return _size; }
+  };
+}
+
+#endif //MOCHIMOCHI_MAPPED_FILE_HPP_
@@ -0,0 +1,215 @@
+#ifndef MOCHIMOCHI_PARALLEL_SVMLIGHT_READER_HPP_
+#define MOCHIMOCHI_PARALLEL_SVMLIGHT_READER_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./feature_hasher.hpp"
+#include "./mapped_file.hpp"
+#include "./parse_svmlight.hpp"
+#include "./svmlight_reader.hpp"
+
+namespace utility {
+  /**
+   * Parses a memory mapped svmlight file on a pool of worker threads while the caller
+   * consumes the examples in their original order.
+   *
+   * The file is cut into chunks of about `chunk_size` bytes on line boundaries. Workers claim
+   * chunks in file order and parse each into one of `n_threads * 2` slots; a worker waits
+   * when every slot is still held by an unread chunk, which bounds the memory in flight.
+   * The consumer side has the same interface as SvmlightReader:
+   *
+   *   for(const auto& example : utility::ParallelSvmlightReader<std::size_t>(path, dim, 4)) {
+   *     marow.update(example.feature, example.label);
+   *   }
+   *
+   * A reference to an example stays valid until the iterator is incremented. Like SvmlightReader
+   * it can be given a FeatureHasher instead of a dimension.
+   */
+  template<typename T>
+  class ParallelSvmlightReader {
+  private :
+    struct Chunk {
+      std::vector<Example<T>> examples;
+      std::size_t size;
+      bool ready;
+    };
+
+  private :
+    const std::size_t kDim;
+    const std::size_t kThreads;
+
+  private :
+    MappedFile _file;
+    std::unique_ptr<const FeatureHasher> _hasher;
+    std::vector<const char*> _bounds;
+    std::vector<Chunk> _slots;
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _produced;
+    std::condition_variable _consumed;
+    std::size_t _claimed;
+    std::size_t _current;
+    std::size_t _position;
+    bool _acquired;
+    bool _stop;
+
+  private :
+    ParallelSvmlightReader(const std::string& path,
+                           const std::size_t dim,
+                           const FeatureHasher* hasher,
+                           const std::size_t n_threads,
+                           const std::size_t chunk_size)
+      : kDim(dim),
+        kThreads(n_threads),
+        _file(path),
+        _hasher(hasher == nullptr ? nullptr : new FeatureHasher(*hasher)),
+        _slots(n_threads * 2) {
+      assert(dim > 0);
+      assert(n_threads > 0);
+      assert(chunk_size > 0);
+
+      auto cursor = _file.begin();
+      _bounds.push_back(cursor);
+      while (cursor != _file.end()) {
+        cursor += std::min<std::size_t>(chunk_size, _file.end() - cursor);
+        if (cursor != _file.end()) {
+          const auto newline = static_cast<const char*>(std::memchr(cursor, '\n', _file.end() - cursor));
+          cursor = (newline == nullptr) ? _file.end() : newline + 1;
+        }
+        _bounds.push_back(cursor);
+      }
+
+      start();
+    }
+
+  public :
+    ParallelSvmlightReader(const std::string& path,
+                           const std::size_t dim,
+                           const std::size_t n_threads = std::max(1u, std::thread::hardware_concurrency()),
+                           const std::size_t chunk_size = 1 << 20)
+      : ParallelSvmlightReader(path, dim, nullptr, n_threads, chunk_size) {
+    }
+
+    ParallelSvmlightReader(const std::string& path,
+                           const FeatureHasher& hasher,
+                           const std::size_t n_threads = std::max(1u, std::thread::hardware_concurrency()),
+                           const std::size_t chunk_size = 1 << 20)
+      : ParallelSvmlightReader(path, hasher.dim(), &hasher, n_threads, chunk_size) {
+    }
+
+    ParallelSvmlightReader(const ParallelSvmlightReader&) = delete;
+    ParallelSvmlightReader& operator=(const ParallelSvmlightReader&) = delete;
+
+    virtual ~ParallelSvmlightReader() {
+      stop();
+    }
+
+  private :
+    std::size_t n_chunks() const {
+      return _bounds.size() - 1;
+    }
+
+    void start() {
+      _claimed = 0;
+      _current = 0;
+      _position = 0;
+      _acquired = false;
+      _stop = false;
+      for (auto& slot : _slots) { slot.ready = false; }
+      for (std::size_t i = 0; i < kThreads; ++i) {
+        _workers.emplace_back([this] { work(); });
+      }
+    }
+
+    void stop() {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+      }
+      _consumed.notify_all();
+      for (auto& worker : _workers) { worker.join(); }
+      _workers.clear();
+    }
+
+    void work() {
+      while (true) {
+        std::size_t chunk;
+        {
+          std::unique_lock<std::mutex> lock(_mutex);
+          _consumed.wait(lock, [&] {
+              return _stop || _claimed >= n_chunks() || _claimed < _current + _slots.size();
+            });
+          if (_stop || _claimed >= n_chunks()) { return; }
+          chunk = _claimed++;
+        }
+
+        // The slot of chunk i was released by the consumer when it moved past chunk i - slots,
+        // so it is owned by this worker until it is marked ready.
+        auto& slot = _slots[chunk % _slots.size()];
+        slot.size = 0;
+        auto cursor = _bounds[chunk];
+        const auto last = _bounds[chunk + 1];
+        while (cursor != last) {
+          const auto line = next_line(cursor, last);
+          if (slot.examples.size() <= slot.size) { slot.examples.emplace_back(); }
+          const auto parsed = _hasher ? parse_svmlight_line(line.first, line.second, *_hasher, slot.examples[slot.size])
+                                      : parse_svmlight_line(line.first, line.second, kDim, slot.examples[slot.size]);
+          if (parsed) { ++slot.size; }
+        }
+
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          slot.ready = true;
+        }
+        _produced.notify_all();
+      }
+    }
+
+  public :
+    using value_type = Example<T>;
+    using iterator = ExampleIterator<ParallelSvmlightReader>;
+
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(); }
+
+    /**
+     * The next example in file order, or nullptr at the end of the file.
+     * Blocks until the chunk holding it has been parsed.
+     */
+    const Example<T>* next() {
+      while (_current < n_chunks()) {
+        auto& slot = _slots[_current % _slots.size()];
+        if (!_acquired) {
+          std::unique_lock<std::mutex> lock(_mutex);
+          _produced.wait(lock, [&] { return slot.ready; });
+          _acquired = true;
+          _position = 0;
+        }
+        if (_position < slot.size) { return &slot.examples[_position++]; }
+
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          slot.ready = false;
+          _acquired = false;
+          ++_current;
+        }
+        _consumed.notify_all();
+      }
+      return nullptr;
+    }
+
+    void rewind() {
+      stop();
+      start();
+    }
+  };
+}
+
+#endif //MOCHIMOCHI_PARALLEL_SVMLIGHT_READER_HPP_
@@ -0,0 +1,254 @@
+#ifndef MOCHIMOCHI_PARSE_SVMLIGHT_HPP_
+#define MOCHIMOCHI_PARSE_SVMLIGHT_HPP_
+
+#include <Eigen/Sparse>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+namespace utility {
+  namespace detail {
+    inline bool is_blank(const char c) {
+      return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    inline const char* skip_blanks(const char* first, const char* last) {
+      while (first != last && is_blank(*first)) { ++first; }
+      return first;
+    }
+
+    inline const char* skip_token(const char* first, const char* last) {
+      while (first != last && !is_blank(*first)) { ++first; }
+      return first;
+    }
+
+    // An index that overflows std::size_t saturates to its maximum, which no dim accepts,
+    // instead of wrapping around to an index that could look valid.
+    inline bool parse_index(const char*& first, const char* last, std::size_t& index) {
+      constexpr auto kMax = std::numeric_limits<std::size_t>::max();
+      auto p = first;
+      std::size_t value = 0;
+      while (p != last && *p >= '0' && *p <= '9') {
+        const auto digit = static_cast<std::size_t>(*p - '0');
+        value = (value > (kMax - digit) / 10) ? kMax : value * 10 + digit;
+        ++p;
+      }
+      if (p == first) { return false; }
+      index = value;
+      first = p;
+      return true;
+    }
+
+    // Decimal to double without locale or allocation. Numbers whose mantissa fits in 53 bits and
+    // whose decimal exponent is at most 22 are exact (Clinger's fast path); anything else is
+    // copied to a stack buffer and handed to strtod.
+    inline bool parse_double(const char*& first, const char* last, double& out) {
+      static const double kPow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+      };
+
+      auto p = first;
+      auto negative = false;
+      if (p != last && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        ++p;
+      }
+
+      std::uint64_t mantissa = 0;
+      auto digits = 0;
+      auto exponent = 0;
+      auto any_digit = false;
+
+      for (; p != last && *p >= '0' && *p <= '9'; ++p) {
+        any_digit = true;
+        if (mantissa == 0 && *p == '0') { continue; }
+        if (digits < 19) {
+          mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+        } else {
+          ++exponent;
+        }
+        ++digits;
+      }
+      if (p != last && *p == '.') {
+        for (++p; p != last && *p >= '0' && *p <= '9'; ++p) {
+          any_digit = true;
+          if (mantissa == 0 && *p == '0') { --exponent; continue; }
+          if (digits < 19) {
+            mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+            --exponent;
+          }
+          ++digits;
+        }
+      }
+      if (!any_digit) { return false; }
+
+      if (p != last && (*p == 'e' || *p == 'E')) {
+        auto q = p + 1;
+        auto exponent_negative = false;
+        if (q != last && (*q == '+' || *q == '-')) {
+          exponent_negative = (*q == '-');
+          ++q;
+        }
+        if (q != last && *q >= '0' && *q <= '9') {
+          auto e = 0;
+          for (; q != last && *q >= '0' && *q <= '9'; ++q) {
+            if (e < 100000) { e = e * 10 + (*q - '0'); }
+          }
+          exponent += exponent_negative ? -e : e;
+          p = q;
+        }
+      }
+
+      if (digits <= 19 && mantissa <= (std::uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+        auto value = static_cast<double>(mantissa);
+        value = (exponent < 0) ? value / kPow10[-exponent] : value * kPow10[exponent];
+        out = negative ? -value : value;
+        first = p;
+        return true;
+      }
+
+      const auto length = static_cast<std::size_t>(p - first);
+      char buffer[128];
+      if (length < sizeof(buffer)) {
+        std::copy(first, p, buffer);
+        buffer[length] = '\0';
+        out = std::strtod(buffer, nullptr);
+      } else {
+        out = std::strtod(std::string(first, p).c_str(), nullptr);
+      }
+      first = p;
+      return true;
+    }
+
+    // An integral label is read as an integer token ("+1", "-1", "3", also "3.0") that has to
+    // fit in T: a fractional label, or a negative one for an unsigned T, is rejected rather
+    // than truncated by a cast.
+    template<typename T>
+    inline bool parse_label(const char*& first, const char* last, T& label, std::true_type) {
+      auto p = first;
+      auto negative = false;
+      if (p != last && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        ++p;
+      }
+
+      const auto digits = p;
+      std::uint64_t magnitude = 0;
+      for (; p != last && *p >= '0' && *p <= '9'; ++p) {
+        const auto digit = static_cast<std::uint64_t>(*p - '0');
+        if (magnitude > (std::numeric_limits<std::uint64_t>::max() - digit) / 10) { return false; }
+        magnitude = magnitude * 10 + digit;
+      }
+      if (p == digits) { return false; }
+      if (p != last && *p == '.') {
+        for (++p; p != last && *p == '0'; ++p) { }
+      }
+      if (p != last && !is_blank(*p)) { return false; }
+
+      const auto max = static_cast<std::uint64_t>(std::numeric_limits<T>::max());
+      if (!negative || magnitude == 0) {
+        if (magnitude > max) { return false; }
+        label = static_cast<T>(magnitude);
+      } else {
+        if (!std::is_signed<T>::value || magnitude - 1 > max) { return false; }
+        label = static_cast<T>(-static_cast<T>(magnitude - 1) - 1);
+      }
+      first = p;
+      return true;
+    }
+
+    template<typename T>
+    inline bool parse_label(const char*& first, const char* last, T& label, std::false_type) {
+      double value;
+      if (!parse_double(first, last, value)) { return false; }
+      label = static_cast<T>(value);
+      return true;
+    }
+
+    template<typename T>
+    inline bool parse_label(const char*& first, const char* last, T& label) {
+      return parse_label(first, last, label, std::is_integral<T>());
+    }
+  }
+
+  /**
+   * A parsed svmlight example. Reusing the same Example across lines keeps the
+   * feature storage allocated.
+   */
+  template<typename T>
+  struct Example {
+    T label;
+    Eigen::SparseVector<double> feature;
+  };
+
+  /**
+   * Parse one svmlight line "<label> <index>:<value> ..." held in [first, last).
+   *
+   * The feature is refilled in place, so passing the same vector for every line reuses its
+   * storage and steady-state parsing does no heap allocation. Indices are 1-based like read_ones;
+   * indices outside [1, dim] and malformed tokens (e.g. "qid:3") are dropped.
+   * Returns false for blank and comment lines, and for a label that T cannot hold.
+   */
+  template<typename T>
+  inline bool parse_svmlight_line(const char* first,
+                                  const char* last,
+                                  const std::size_t dim,
+                                  T& label,
+                                  Eigen::SparseVector<double>& feature) {
+    auto p = detail::skip_blanks(first, last);
+    if (p == last || *p == '#') { return false; }
+
+    if (!detail::parse_label(p, last, label)) { return false; }
+
+    feature.resize(dim);
+    std::size_t previous = 0;
+    while (true) {
+      p = detail::skip_blanks(p, last);
+      if (p == last || *p == '#') { break; }
+
+      std::size_t index;
+      double value;
+      if (!detail::parse_index(p, last, index) || p == last || *p != ':') {
+        p = detail::skip_token(p, last);
+        continue;
+      }
+      ++p;
+      // The value must end the token: "1:2abc" is skipped, not read as 2.
+      if (!detail::parse_double(p, last, value) || (p != last && !detail::is_blank(*p))) {
+        p = detail::skip_token(p, last);
+        continue;
+      }
+      if (index == 0 || index > dim) { continue; }
+
+      if (index > previous) {
+        feature.insertBack(index - 1) = value;
+        previous = index;
+      } else {
+        feature.coeffRef(index - 1) = value;
+      }
+    }
+    return true;
+  }
+
+  template<typename T>
+  inline bool parse_svmlight_line(const std::string& line,
+                                  const std::size_t dim,
+                                  T& label,
+                                  Eigen::SparseVector<double>& feature) {
+    return parse_svmlight_line(line.data(), line.data() + line.size(), dim, label, feature);
+  }
+
+  template<typename T>
+  inline bool parse_svmlight_line(const char* first,
+                                  const char* last,
+                                  const std::size_t dim,
+                                  Example<T>& example) {
+    return parse_svmlight_line(first, last, dim, example.label, example.feature);
+  }
+}
+
+#endif //MOCHIMOCHI_PARSE_SVMLIGHT_HPP_
@@ -0,0 +1,87 @@
+#ifndef MOCHIMOCHI_SPSC_RING_HPP_
+#define MOCHIMOCHI_SPSC_RING_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <vector>
+
+namespace utility {
+  /**
+   * Lock-free single-producer single-consumer ring of preallocated slots.
+   *
+   * The producer fills the slot returned by back() and publishes it with push(); the consumer
+   * reads the slot returned by front() and hands it back with pop(). Slots are reused in place,
+   * so whatever storage they own survives from one lap to the next.
+   */
+  template<typename T>
+  class SpscRing {
+  private :
+    const std::size_t kCapacity;
+    const std::size_t kMask;
+
+  private :
+    std::vector<T> _slots;
+    char _pad0[64];
+    std::atomic<std::size_t> _head;
+    char _pad1[64];
+    std::atomic<std::size_t> _tail;
+    char _pad2[64];
+
+  private :
+    static std::size_t round_up(const std::size_t capacity) {
+      std::size_t power = 1;
+      while (power < capacity) { power <<= 1; }
+      return power;
+    }
+
+  public :
+    explicit SpscRing(const std::size_t capacity)
+      : kCapacity(round_up(capacity)),
+        kMask(kCapacity - 1),
+        _slots(kCapacity),
+        _head(0),
+        _tail(0) {
+      assert(capacity > 0);
+    }
+
+    virtual ~SpscRing() { }
+
+  public :
+    std::size_t capacity() const { return kCapacity; }
+
+    /* Number of published slots; approximate while the two sides are running. */
+    std::size_t size() const {
+      // head first: tail only grows, so tail - head cannot go below zero.
+      const auto head = _head.load(std::memory_order_acquire);
+      const auto tail = _tail.load(std::memory_order_acquire);
+      return std::min(tail - head, kCapacity);
+    }
+
+    /* Producer: the free slot to fill next, or nullptr when the ring is full. */
+    T* back() {
+      const auto tail = _tail.load(std::memory_order_relaxed);
+      if (tail - _head.load(std::memory_order_acquire) == kCapacity) { return nullptr; }
+      return &_slots[tail & kMask];
+    }
+
+    /* Producer: publish the slot returned by back(). */
+    void push() {
+      _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /* Consumer: the oldest published slot, or nullptr when the ring is empty. */
+    T* front() {
+      const auto head = _head.load(std::memory_order_relaxed);
+      if (head == _tail.load(std::memory_order_acquire)) { return nullptr; }
+      return &_slots[head & kMask];
+    }
+
+    /* Consumer: release the slot returned by front(). */
+    void pop() {
+      _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+  };
+}
+
+#endif //MOCHIMOCHI_SPSC_RING_HPP_
@@ -0,0 +1,155 @@
+#ifndef MOCHIMOCHI_SVMLIGHT_READER_HPP_
+#define MOCHIMOCHI_SVMLIGHT_READER_HPP_
+
+#include <cassert>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include "./feature_hasher.hpp"
+#include "./mapped_file.hpp"
+#include "./parse_svmlight.hpp"
+
+namespace utility {
+  /**
+   * Returns the line starting at `first` as [first, end of line) and moves `first` past its newline.
+   * Lines are views into the given buffer, nothing is copied.
+   */
+  inline std::pair<const char*, const char*> next_line(const char*& first, const char* last) {
+    const auto begin = first;
+    const auto newline = static_cast<const char*>(std::memchr(first, '\n', last - first));
+    if (newline == nullptr) {
+      first = last;
+      return std::make_pair(begin, last);
+    }
+    first = newline + 1;
+    return std::make_pair(begin, newline);
+  }
+
+  /**
+   * Input iterator over any reader exposing `const value_type* next()`, which returns
+   * nullptr once the input is exhausted.
+   */
+  template<typename ReaderT>
+  class ExampleIterator {
+  public :
+    using iterator_category = std::input_iterator_tag;
+    using value_type = typename ReaderT::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+  private :
+    ReaderT* _reader;
+    pointer _example;
+
+  public :
+    explicit ExampleIterator(ReaderT* reader = nullptr)
+      : _reader(reader),
+        _example(nullptr) {
+      ++(*this);
+    }
+
+    reference operator*() const { return *_example; }
+    pointer operator->() const { return _example; }
+
+    ExampleIterator& operator++() {
+      if (_reader != nullptr) {
+        _example = _reader->next();
+        if (_example == nullptr) { _reader = nullptr; }
+      }
+      return *this;
+    }
+
+    bool operator==(const ExampleIterator& other) const { return _reader == other._reader; }
+    bool operator!=(const ExampleIterator& other) const { return _reader != other._reader; }
+  };
+
+  /**
+   * Streams the examples of a memory mapped svmlight file.
+   *
+   *   for(const auto& example : utility::SvmlightReader<int>(path, dim)) {
+   *     arow.update(example.feature, example.label);
+   *   }
+   *
+   * Constructed with a FeatureHasher instead of a dimension, feature names are hashed into
+   * hasher.dim() coordinates while parsing.
+   *
+   * Every example is parsed into the same buffer, so a reference obtained from the
+   * iterator is only valid until it is incremented. Iteration continues from the current
+   * position; call rewind() to start another epoch.
+   */
+  template<typename T>
+  class SvmlightReader {
+  private :
+    const std::size_t kDim;
+
+  private :
+    MappedFile _file;
+    const char* _cursor;
+    Example<T> _example;
+    std::unique_ptr<const FeatureHasher> _hasher;
+
+  public :
+    SvmlightReader(const std::string& path, const std::size_t dim)
+      : kDim(dim),
+        _file(path),
+        _cursor(_file.begin()) {
+      assert(dim > 0);
+    }
+
+    SvmlightReader(const std::string& path, const FeatureHasher& hasher)
+      : kDim(hasher.dim()),
+        _file(path),
+        _cursor(_file.begin()),
+        _hasher(new FeatureHasher(hasher)) {
+    }
+
+    virtual ~SvmlightReader() { }
+
+  public :
+    using value_type = Example<T>;
+    using iterator = ExampleIterator<SvmlightReader>;
+
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(); }
+
+    /**
+     * Parse the next example into `example`. Returns false at the end of the file.
+     */
+    bool next(Example<T>& example) {
+      while (_cursor != _file.end()) {
+        const auto line = next_line(_cursor, _file.end());
+        const auto parsed = _hasher ? parse_svmlight_line(line.first, line.second, *_hasher, example)
+                                    : parse_svmlight_line(line.first, line.second, kDim, example);
+        if (parsed) { return true; }
+      }
+      return false;
+    }
+
+    /**
+     * Parse the next example into the reader's own buffer. Returns nullptr at the end of the file.
+     */
+    const Example<T>* next() {
+      return next(_example) ? &_example : nullptr;
+    }
+
+    /**
+     * Parse up to `n` examples into the front of `batch` and return how many were read.
+     * The batch only grows, so its examples keep their storage between calls.
+     */
+    std::size_t next_batch(std::vector<Example<T>>& batch, const std::size_t n) {
+      if (batch.size() < n) { batch.resize(n); }
+      std::size_t count = 0;
+      while (count < n && next(batch[count])) { ++count; }
+      return count;
+    }
+
+    void rewind() {
+      _cursor = _file.begin();
+    }
+  };
+}
+
+#endif //MOCHIMOCHI_SVMLIGHT_READER_HPP_
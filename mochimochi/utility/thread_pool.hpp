@@ -0,0 +1,135 @@
+#ifndef MOCHIMOCHI_THREAD_POOL_HPP_
+#define MOCHIMOCHI_THREAD_POOL_HPP_
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utility {
+  /**
+   * A fixed set of threads that run one short data-parallel loop at a time, for loops that
+   * are too small to pay for starting threads, e.g. the per-class updates of one example:
+   *
+   *   utility::ThreadPool pool(4);
+   *   pool.parallel_for(n_class, [&](const std::size_t first, const std::size_t last) {
+   *     for (auto c = first; c < last; ++c) { ... }
+   *   });
+   *
+   * parallel_for() cuts [0, n) into size() contiguous ranges, runs the first one on the
+   * calling thread and the others on the workers, and returns once all of them are done. It
+   * does not allocate. Between loops the workers spin for a short while before they sleep,
+   * so back to back calls do not go through the kernel. The function must not throw.
+   */
+  class ThreadPool {
+  private :
+    // Spins (with yield) before a worker sleeps on the condition variable.
+    static constexpr int kSpin = 4096;
+
+  private :
+    const std::size_t kThreads;
+
+  private :
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _started;
+    std::atomic<std::size_t> _generation;
+    std::atomic<std::size_t> _running;
+    std::atomic<bool> _stop;
+
+    // The current loop, type erased without an allocation.
+    const void* _function;
+    void (*_invoke)(const void*, std::size_t, std::size_t);
+    std::size_t _size;
+
+  public :
+    explicit ThreadPool(const std::size_t n_threads)
+      : kThreads(n_threads),
+        _generation(0),
+        _running(0),
+        _stop(false),
+        _function(nullptr),
+        _invoke(nullptr),
+        _size(0) {
+      assert(n_threads > 0);
+      for (std::size_t id = 1; id < kThreads; ++id) {
+        _workers.emplace_back([this, id] { work(id); });
+      }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    virtual ~ThreadPool() {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop.store(true, std::memory_order_relaxed);
+        _generation.fetch_add(1, std::memory_order_release);
+      }
+      _started.notify_all();
+      for (auto& worker : _workers) { worker.join(); }
+    }
+
+  public :
+    /**
+     * Number of threads, the calling thread included.
+     */
+    std::size_t size() const {
+      return kThreads;
+    }
+
+    template <typename FunctionT>
+    void parallel_for(const std::size_t n, const FunctionT& function) {
+      if (kThreads == 1 || n <= 1) {
+        function(std::size_t(0), n);
+        return;
+      }
+
+      _function = &function;
+      _invoke = [](const void* f, const std::size_t first, const std::size_t last) {
+        (*static_cast<const FunctionT*>(f))(first, last);
+      };
+      _size = n;
+      _running.store(kThreads - 1, std::memory_order_relaxed);
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _generation.fetch_add(1, std::memory_order_release);
+      }
+      _started.notify_all();
+
+      run(0);
+      while (_running.load(std::memory_order_acquire) != 0) { std::this_thread::yield(); }
+    }
+
+  private :
+    void run(const std::size_t id) {
+      const auto first = _size * id / kThreads;
+      const auto last = _size * (id + 1) / kThreads;
+      if (first < last) { _invoke(_function, first, last); }
+    }
+
+    void work(const std::size_t id) {
+      std::size_t seen = 0;
+      while (true) {
+        auto spin = 0;
+        while (_generation.load(std::memory_order_acquire) == seen && spin < kSpin) {
+          std::this_thread::yield();
+          ++spin;
+        }
+        if (_generation.load(std::memory_order_acquire) == seen) {
+          std::unique_lock<std::mutex> lock(_mutex);
+          _started.wait(lock, [&] { return _generation.load(std::memory_order_acquire) != seen; });
+        }
+        seen = _generation.load(std::memory_order_acquire);
+
+        if (_stop.load(std::memory_order_relaxed)) { return; }
+        run(id);
+        _running.fetch_sub(1, std::memory_order_acq_rel);
+      }
+    }
+  };
+}
+
+#endif //MOCHIMOCHI_THREAD_POOL_HPP_